@@ -0,0 +1,336 @@
+// Volvamos al MapMonitor del paso 8. Tiene un problema de uso real: las entradas
+// nunca vencen, entonces el mapa crece para siempre.
+//
+// La solución ingenua es un thread "barrendero" que recorre TODO el mapa con el
+// mutex tomado buscando entradas vencidas. Mientras recorre, nadie más puede usar
+// el monitor: una critical section enorme.
+//
+// Vamos a agregar un TTL por entrada y a registrar los vencimientos en una
+// "rueda de tiempo jerárquica" (hierarchical timing wheel): agendar y cancelar
+// un vencimiento es O(1), y un thread "expirer" desaloja las entradas vencidas
+// de a tandas chicas, soltando el mutex entre tanda y tanda.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/* ************************************************************************* *
+ * TIMING WHEEL - Listas intrusivas y niveles
+ * ************************************************************************* */
+
+// Cada vencimiento es un nodo de una lista doblemente enlazada circular. El nodo
+// vive adentro de la entrada del mapa (los nodos de std::map no se mueven), así
+// que agendar o cancelar es solamente enlazar o desenlazar punteros: O(1).
+struct TimerNode {
+    TimerNode *prev;
+    TimerNode *next;
+    int key;
+    uint64_t deadline;
+
+    TimerNode() : prev(this), next(this), key(0), deadline(0) {}
+
+    bool isLinked() const {
+        return next != this;
+    }
+
+    void unlink() {
+        prev->next = next;
+        next->prev = prev;
+        prev = next = this;
+    }
+
+    // Enlaza "node" al final de la lista cuyo centinela es this.
+    void pushBack(TimerNode *node) {
+        node->prev = prev;
+        node->next = this;
+        prev->next = node;
+        prev = node;
+    }
+
+    // Mueve todos los nodos de "other" al final de esta lista, en O(1).
+    void spliceBack(TimerNode &other) {
+        if (!other.isLinked()) {
+            return;
+        }
+        other.next->prev = prev;
+        prev->next = other.next;
+        other.prev->next = this;
+        prev = other.prev;
+        other.prev = other.next = &other;
+    }
+};
+
+// La rueda tiene varios niveles de 64 ranuras. El nivel 0 avanza de a un tick, el
+// nivel 1 de a 64 ticks, el nivel 2 de a 64*64 ticks, etc. Cuando el nivel 0 da
+// una vuelta completa, la ranura que toca del nivel 1 se "derrama" (cascade)
+// hacia los niveles de abajo. Es la misma idea que los timers del kernel de Linux.
+class TimingWheel {
+private:
+    static const int kLevels = 4;
+    static const int kSlotBits = 6;
+    static const int kSlots = 1 << kSlotBits;
+    static const uint64_t kSlotMask = kSlots - 1;
+    static const uint64_t kMaxDelta = (uint64_t(1) << (kLevels * kSlotBits)) - 1;
+
+    TimerNode slots[kLevels][kSlots];
+    // Acá se acumulan los vencidos hasta que alguien los desaloje.
+    TimerNode expired;
+    // Próximo tick a procesar.
+    uint64_t nextTick;
+
+    void place(TimerNode *node) {
+        uint64_t deadline = node->deadline;
+        if (deadline < nextTick) {
+            deadline = nextTick;
+        }
+        uint64_t delta = deadline - nextTick;
+        if (delta > kMaxDelta) {
+            delta = kMaxDelta;
+            deadline = nextTick + kMaxDelta;
+        }
+        int level = 0;
+        while (level < kLevels - 1 && delta >= (uint64_t(1) << ((level + 1) * kSlotBits))) {
+            ++level;
+        }
+        uint64_t slot = (deadline >> (level * kSlotBits)) & kSlotMask;
+        slots[level][slot].pushBack(node);
+    }
+
+    void cascade(int level, uint64_t slot) {
+        TimerNode pending;
+        pending.spliceBack(slots[level][slot]);
+        while (pending.isLinked()) {
+            TimerNode *node = pending.next;
+            node->unlink();
+            place(node);
+        }
+    }
+
+public:
+    explicit TimingWheel(uint64_t firstTick) : nextTick(firstTick) {}
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    void schedule(TimerNode *node, uint64_t deadline) {
+        node->unlink();
+        node->deadline = deadline;
+        place(node);
+    }
+
+    // Cancelar es desenlazar: funciona tanto si el nodo está en una ranura como
+    // si ya está en la lista de vencidos.
+    void cancel(TimerNode *node) {
+        node->unlink();
+    }
+
+    bool hasPendingTicks(uint64_t now) const {
+        return nextTick <= now;
+    }
+
+    // Procesa un único tick: derrama los niveles superiores si corresponde y pasa
+    // la ranura actual del nivel 0 a la lista de vencidos.
+    void advance() {
+        uint64_t index = nextTick & kSlotMask;
+        if (index == 0) {
+            for (int level = 1; level < kLevels; ++level) {
+                uint64_t slot = (nextTick >> (level * kSlotBits)) & kSlotMask;
+                cascade(level, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+        expired.spliceBack(slots[0][index]);
+        ++nextTick;
+    }
+
+    // Devuelve el próximo vencido (ya desenlazado) o NULL si no hay.
+    TimerNode *popExpired() {
+        if (!expired.isLinked()) {
+            return NULL;
+        }
+        TimerNode *node = expired.next;
+        node->unlink();
+        return node;
+    }
+};
+
+/* ************************************************************************* *
+ * MONITOR - putIfAbsent con TTL y un expirer que no acapara el mutex
+ * ************************************************************************* */
+
+class ExpiringMapMonitor {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // Cuántos ticks y cuántos desalojos hacemos, como máximo, por cada vez que
+    // tomamos el mutex. Así ninguna critical section del expirer es "larga".
+    static const int kMaxTicksPerBatch = 64;
+    static const int kMaxEvictionsPerBatch = 32;
+
+    struct Entry {
+        int value;
+        TimerNode timer;
+    };
+
+    std::map<int, Entry> internal;
+    std::mutex mutex;
+
+    const Clock::time_point epoch;
+    const Clock::duration resolution;
+    TimingWheel wheel;
+
+    bool keepExpiring;
+    std::condition_variable stopRequested;
+    std::thread expirer;
+
+    bool contains(int key) {
+        return internal.find(key) != internal.end();
+    }
+
+    uint64_t currentTick() {
+        return (Clock::now() - epoch) / resolution;
+    }
+
+    // Una tanda acotada: avanza algunos ticks y desaloja algunos vencidos.
+    // Devuelve true si quedó trabajo pendiente.
+    bool expireBatch() {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t now = currentTick();
+        for (int i = 0; i < kMaxTicksPerBatch && wheel.hasPendingTicks(now); ++i) {
+            wheel.advance();
+        }
+        for (int i = 0; i < kMaxEvictionsPerBatch; ++i) {
+            TimerNode *node = wheel.popExpired();
+            if (node == NULL) {
+                return wheel.hasPendingTicks(now);
+            }
+            internal.erase(node->key);
+        }
+        return true;
+    }
+
+    void expireLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (keepExpiring) {
+            stopRequested.wait_for(lock, resolution);
+            lock.unlock();
+            // Entre tanda y tanda soltamos el mutex, así los demás threads
+            // pueden entrar al monitor.
+            while (expireBatch()) {
+                std::this_thread::yield();
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    explicit ExpiringMapMonitor(std::chrono::milliseconds resolution = std::chrono::milliseconds(10)) :
+        epoch(Clock::now()), resolution(resolution), wheel(0), keepExpiring(true),
+        expirer(&ExpiringMapMonitor::expireLoop, this) {
+    }
+
+    ExpiringMapMonitor(const ExpiringMapMonitor&) = delete;
+    ExpiringMapMonitor& operator=(const ExpiringMapMonitor&) = delete;
+
+    // Sin TTL: la entrada no vence nunca, como en el paso 8.
+    void putIfAbsent(int key, int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!contains(key)) {
+            internal[key].value = value;
+        }
+    }
+
+    void putIfAbsent(int key, int value, std::chrono::milliseconds ttl) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!contains(key)) {
+            Entry &entry = internal[key];
+            entry.value = value;
+            entry.timer.key = key;
+            // Redondeamos para arriba: nunca vence antes de su TTL.
+            uint64_t ticks = (ttl + resolution - Clock::duration(1)) / resolution;
+            wheel.schedule(&entry.timer, currentTick() + ticks);
+        }
+    }
+
+    void printIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (contains(key)) {
+            std::cout << "Par rescatado! (" << key << ", " << internal.at(key).value << ")" << std::endl;
+        }
+    }
+
+    void removeIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = internal.find(key);
+        if (it != internal.end()) {
+            wheel.cancel(&it->second.timer);
+            internal.erase(it);
+        }
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return internal.size();
+    }
+
+    // You spawn a thread, you join a thread. Aunque el thread sea nuestro.
+    ~ExpiringMapMonitor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            keepExpiring = false;
+        }
+        stopRequested.notify_all();
+        expirer.join();
+    }
+};
+
+void usingTheExpiringMonitor() {
+    ExpiringMapMonitor map;
+    // Cada clave vive "key * 10" milisegundos; las pares no vencen nunca.
+    for (int key = 0; key < 100; ++key) {
+        if (key % 2 == 0) {
+            map.putIfAbsent(key, key);
+        } else {
+            map.putIfAbsent(key, key, std::chrono::milliseconds(key * 10));
+        }
+    }
+
+    std::thread remover_thread([&] {
+        for (int key = 0; key < 100; key += 4) {
+            map.removeIfPresent(key);
+        }
+    });
+
+    std::thread printer_thread([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        for (int key = 99; key >= 0; --key) {
+            map.printIfPresent(key);
+        }
+    });
+
+    printer_thread.join();
+    remover_thread.join();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    std::cout << "Quedan " << map.size() << " entradas (las que no tienen TTL)" << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+    usingTheExpiringMonitor();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. El expirer también es un cliente del monitor: sus critical sections tienen que
+//    ser tan cortas como las de cualquier otro.
+// 2. Acotar el trabajo por cada toma del mutex (kMaxTicksPerBatch, kMaxEvictionsPerBatch)
+//    acota la latencia que ven los demás threads, a cambio de tomar el mutex más veces.
+// 3. La rueda no es exacta: un vencimiento se resuelve con la granularidad de un tick.
+// 4. El destructor avisa al expirer con una condition variable y lo joinea. Nada de
+//    detach().
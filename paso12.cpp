@@ -0,0 +1,303 @@
+// Muchas veces el MapMonitor del paso 8 termina usándose como cache. Pero un cache
+// sin capacidad máxima es simplemente una pérdida de memoria con buena prensa.
+//
+// Acotemos la capacidad y desalojemos con el algoritmo CLOCK. Un LRU "de libro"
+// mueve la entrada al frente de una lista en CADA lectura: eso es escribir punteros
+// compartidos en cada hit. CLOCK aproxima LRU marcando un bit de referencia en el
+// hit, y deja el trabajo pesado para el momento de desalojar.
+//
+// Como un hit no modifica la estructura (solo el bit, que es atómico), los hits
+// pueden correr en paralelo bajo un lock de lectura. Solo insertar, borrar y
+// desalojar toman el lock de escritura.
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+/* ************************************************************************* *
+ * LOCKS - Lectores en paralelo, escritores de a uno
+ * ************************************************************************* */
+
+// En C++11 no hay std::shared_mutex: envolvemos pthread_rwlock como el Mutex del
+// paso 9.
+class ReaderWriterLock {
+private:
+    pthread_rwlock_t c_rwlock;
+
+public:
+    // Por defecto glibc prefiere a los lectores: con hits constantes, un
+    // putIfAbsent podría esperar para siempre. Pedimos preferencia de escritores.
+    ReaderWriterLock() {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&c_rwlock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+
+    ReaderWriterLock(const ReaderWriterLock&) = delete;
+    ReaderWriterLock& operator=(const ReaderWriterLock&) = delete;
+
+    void lockRead() {
+        pthread_rwlock_rdlock(&c_rwlock);
+    }
+
+    void lockWrite() {
+        pthread_rwlock_wrlock(&c_rwlock);
+    }
+
+    void unlock() {
+        pthread_rwlock_unlock(&c_rwlock);
+    }
+
+    ~ReaderWriterLock() {
+        pthread_rwlock_destroy(&c_rwlock);
+    }
+};
+
+class ReadLock {
+private:
+    ReaderWriterLock &rwlock;
+
+public:
+    explicit ReadLock(ReaderWriterLock &rwlock) : rwlock(rwlock) {
+        rwlock.lockRead();
+    }
+
+    ~ReadLock() {
+        rwlock.unlock();
+    }
+};
+
+class WriteLock {
+private:
+    ReaderWriterLock &rwlock;
+
+public:
+    explicit WriteLock(ReaderWriterLock &rwlock) : rwlock(rwlock) {
+        rwlock.lockWrite();
+    }
+
+    ~WriteLock() {
+        rwlock.unlock();
+    }
+};
+
+/* ************************************************************************* *
+ * CACHE - Un Monitor con capacidad acotada y desalojo CLOCK
+ * ************************************************************************* */
+
+class ClockCacheMonitor {
+private:
+    // Las entradas viven en un arreglo fijo que la "aguja" del reloj recorre en
+    // círculo. El bit de referencia es lo único que escribe un hit, y lo escribe
+    // con el lock de LECTURA tomado: por eso tiene que ser atómico, varios hits
+    // concurrentes pueden marcarlo a la vez.
+    struct Slot {
+        int key;
+        int value;
+        std::atomic<bool> referenced;
+
+        Slot() : key(0), value(0), referenced(false) {}
+    };
+
+    std::vector<Slot> slots;
+    std::vector<size_t> freeSlots;
+    std::map<int, size_t> index;
+    size_t hand;
+    ReaderWriterLock rwlock;
+
+    // Los contadores no forman parte de ningún invariante, alcanza con atómicos
+    // "relaxed".
+    std::atomic<unsigned long> hits;
+    std::atomic<unsigned long> misses;
+    std::atomic<unsigned long> evictions;
+
+    // Busca la entrada y, si está, la marca como referenciada. Alcanza con el lock
+    // de lectura: no toca ni el índice ni la aguja.
+    Slot *lookup(int key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        hits.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = slots[it->second];
+        slot.referenced.store(true, std::memory_order_relaxed);
+        return &slot;
+    }
+
+    // Avanza la aguja: a las entradas referenciadas les da una "segunda
+    // oportunidad" (limpia el bit), y desaloja la primera que no lo esté. Con el
+    // lock de escritura tomado no hay hits en vuelo.
+    size_t evictOne() {
+        for (;;) {
+            Slot &slot = slots[hand];
+            size_t victim = hand;
+            hand = (hand + 1) % slots.size();
+            if (slot.referenced.exchange(false, std::memory_order_relaxed)) {
+                continue;
+            }
+            index.erase(slot.key);
+            evictions.fetch_add(1, std::memory_order_relaxed);
+            return victim;
+        }
+    }
+
+    size_t acquireSlot() {
+        if (!freeSlots.empty()) {
+            size_t free = freeSlots.back();
+            freeSlots.pop_back();
+            return free;
+        }
+        return evictOne();
+    }
+
+public:
+    struct Stats {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long evictions;
+    };
+
+    explicit ClockCacheMonitor(size_t capacity) : slots(capacity), hand(0), hits(0),
+        misses(0), evictions(0) {
+        // Sin slots, evictOne no tendría a quién desalojar.
+        if (capacity == 0) {
+            throw std::invalid_argument("La capacidad tiene que ser mayor que 0");
+        }
+        freeSlots.reserve(capacity);
+        for (size_t i = capacity; i > 0; --i) {
+            freeSlots.push_back(i - 1);
+        }
+    }
+
+    ClockCacheMonitor(const ClockCacheMonitor&) = delete;
+    ClockCacheMonitor& operator=(const ClockCacheMonitor&) = delete;
+
+    void putIfAbsent(int key, int value) {
+        WriteLock lock(rwlock);
+        if (index.find(key) != index.end()) {
+            return;
+        }
+        size_t position = acquireSlot();
+        Slot &slot = slots[position];
+        slot.key = key;
+        slot.value = value;
+        // Una entrada nueva no arranca referenciada: si nadie la lee, es la
+        // primera candidata a irse.
+        slot.referenced.store(false, std::memory_order_relaxed);
+        index[key] = position;
+    }
+
+    bool getIfPresent(int key, int &value) {
+        ReadLock lock(rwlock);
+        Slot *slot = lookup(key);
+        if (slot == NULL) {
+            return false;
+        }
+        value = slot->value;
+        return true;
+    }
+
+    void printIfPresent(int key) {
+        ReadLock lock(rwlock);
+        Slot *slot = lookup(key);
+        if (slot != NULL) {
+            std::cout << "Par rescatado! (" << key << ", " << slot->value << ")" << std::endl;
+        }
+    }
+
+    void removeIfPresent(int key) {
+        WriteLock lock(rwlock);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            slots[it->second].referenced.store(false, std::memory_order_relaxed);
+            freeSlots.push_back(it->second);
+            index.erase(it);
+        }
+    }
+
+    size_t size() {
+        ReadLock lock(rwlock);
+        return index.size();
+    }
+
+    Stats stats() const {
+        Stats snapshot;
+        snapshot.hits = hits.load(std::memory_order_relaxed);
+        snapshot.misses = misses.load(std::memory_order_relaxed);
+        snapshot.evictions = evictions.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+};
+
+void usingTheClockCache() {
+    ClockCacheMonitor cache(32);
+
+    std::atomic<bool> scanning(true);
+
+    // Estos dos threads leen todo el tiempo un conjunto "caliente" de 8 claves. Sus
+    // hits no se excluyen entre sí.
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.push_back(std::thread([&] {
+            int value;
+            while (scanning.load()) {
+                for (int key = 0; key < 8; ++key) {
+                    if (!cache.getIfPresent(key, value)) {
+                        cache.putIfAbsent(key, key);
+                    }
+                }
+            }
+        }));
+    }
+
+    // Y este otro recorre muchas claves "frías" que no entran en el cache.
+    std::thread scanner_thread([&] {
+        for (int key = 100; key < 1100; ++key) {
+            cache.putIfAbsent(key, key);
+            // Un scan real hace algo con cada clave, no martilla el lock.
+            std::this_thread::yield();
+        }
+        scanning.store(false);
+    });
+
+    scanner_thread.join();
+    for (size_t i = 0; i < readers.size(); ++i) {
+        readers[i].join();
+    }
+
+    // Las claves calientes sobreviven al scan gracias al bit de referencia.
+    for (int key = 0; key < 8; ++key) {
+        cache.printIfPresent(key);
+    }
+
+    ClockCacheMonitor::Stats stats = cache.stats();
+    std::cout << "Entradas: " << cache.size()
+              << " hits: " << stats.hits
+              << " misses: " << stats.misses
+              << " desalojos: " << stats.evictions << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+    usingTheClockCache();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Un hit toma el lock de LECTURA y solo escribe un bit atómico: no reordena
+//    ninguna lista, así que muchos hits corren en paralelo. Solo insertar, borrar
+//    y desalojar son exclusivos.
+// 2. El std::map del índice se puede leer desde varios threads a la vez, siempre
+//    que nadie lo modifique: eso es justamente lo que garantiza el rwlock.
+// 3. La capacidad es fija, entonces la memoria del cache es predecible.
+// 4. Los contadores son atómicos "relaxed": son estadísticas, no sincronizan nada.
+// 5. CLOCK es una aproximación de LRU. Si el patrón de acceso es un scan gigante,
+//    los bits de referencia protegen a las claves que se leen seguido.
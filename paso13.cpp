@@ -0,0 +1,394 @@
+// Cada vez que el proceso arranca, reconstruimos el mapa con millones de
+// putIfAbsent. El monitor del paso 8 vive solamente en el heap, y el heap muere
+// con el proceso.
+//
+// Pongamos la tabla en un archivo mapeado con mmap. Al reabrir, el "arranque" es
+// mapear el archivo: las páginas se cargan de a poco, recién cuando alguien las
+// toca (page faults), y el mapa está listo en milisegundos. Eso vale si el archivo
+// quedó "limpio" (con un checkpoint después del último cambio); si no, hay que
+// recorrerlo entero para repararlo.
+//
+// La condición para poder hacer esto es que la tabla NO tenga punteros: en la
+// próxima ejecución el archivo se puede mapear en cualquier otra dirección. Todo
+// se expresa con offsets e índices.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ************************************************************************* *
+ * LAYOUT - Qué hay adentro del archivo
+ * ************************************************************************* */
+
+// Solo tipos de tamaño fijo: el archivo tiene que significar lo mismo en la
+// próxima ejecución.
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t clean;          // 1 si el último cambio quedó cubierto por un checkpoint
+    uint64_t capacity;       // cantidad de buckets, potencia de 2
+    uint64_t count;
+    uint64_t bucketsOffset;  // offset (no puntero!) al arreglo de buckets
+    uint64_t tableChecksum;  // checksum de los buckets al momento del checkpoint
+    uint64_t headerChecksum; // checksum de todos los campos anteriores
+};
+
+enum BucketState : uint32_t {
+    EMPTY = 0,
+    FULL = 1,
+    TOMBSTONE = 2
+};
+
+// 16 bytes y alineado: ningún bucket queda partido entre dos páginas. Si no, el
+// kernel podría bajar a disco el "state" de un bucket sin su clave y su valor.
+struct Bucket {
+    int32_t key;
+    int32_t value;
+    uint32_t state;
+    uint32_t padding;
+};
+
+// El header ocupa la página 0 entero, y los buckets arrancan en la página 1.
+static const uint64_t kPageSize = 4096;
+
+static_assert(sizeof(FileHeader) == 56, "El header tiene que tener siempre el mismo layout");
+static_assert(sizeof(Bucket) == 16, "Los buckets tienen que tener siempre el mismo layout");
+static_assert(kPageSize % sizeof(Bucket) == 0, "Un bucket no puede cruzar de página");
+
+static const char kMagic[8] = {'M', 'A', 'P', 'M', 'O', 'N', '1', '3'};
+static const uint32_t kVersion = 2;
+
+// FNV-1a: no es criptográfico, alcanza para detectar un archivo corrupto o truncado.
+static uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+    const unsigned char *bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::runtime_error systemError(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/* ************************************************************************* *
+ * MONITOR - La tabla vive en el archivo, el mutex en el proceso
+ * ************************************************************************* */
+
+class PersistentMapMonitor {
+private:
+    int fd;
+    size_t mappedSize;
+    void *base;
+    FileHeader *header;
+    Bucket *buckets;
+    std::mutex mutex;
+
+    // Mientras el archivo está sucio, "count" cambia en cada operación y no se
+    // vuelve a firmar el header: en ese estado el checksum lo deja afuera.
+    static uint64_t headerChecksumOf(const FileHeader &h) {
+        FileHeader copy = h;
+        if (!copy.clean) {
+            copy.count = 0;
+        }
+        return fnv1a(&copy, offsetof(FileHeader, headerChecksum));
+    }
+
+    uint64_t tableChecksum() const {
+        return fnv1a(buckets, header->capacity * sizeof(Bucket));
+    }
+
+    // Linear probing: devuelve el bucket de la clave, o el primero libre donde
+    // iría. Ojo que un TOMBSTONE no corta la búsqueda.
+    Bucket *probe(int key, bool forInsert) {
+        uint64_t mask = header->capacity - 1;
+        uint64_t i = uint64_t(uint32_t(key) * 2654435761u) & mask;
+        Bucket *firstFree = NULL;
+        for (uint64_t n = 0; n < header->capacity; ++n, i = (i + 1) & mask) {
+            Bucket &bucket = buckets[i];
+            if (bucket.state == FULL && bucket.key == key) {
+                return &bucket;
+            }
+            if (bucket.state != FULL && firstFree == NULL) {
+                firstFree = &bucket;
+            }
+            if (bucket.state == EMPTY) {
+                break;
+            }
+        }
+        return forInsert ? firstFree : NULL;
+    }
+
+    // El "sucio" tiene que estar en disco ANTES de tocar el primer bucket: si no,
+    // un corte de luz puede dejar buckets nuevos con un header que dice "limpio",
+    // y al reabrir nadie repara nada.
+    void markDirty() {
+        if (header->clean) {
+            header->clean = 0;
+            header->headerChecksum = headerChecksumOf(*header);
+            if (msync(base, sizeof(FileHeader), MS_SYNC) != 0) {
+                throw systemError("msync");
+            }
+        }
+    }
+
+    void create(uint64_t capacity) {
+        mappedSize = kPageSize + capacity * sizeof(Bucket);
+        if (ftruncate(fd, mappedSize) != 0) {
+            throw systemError("ftruncate");
+        }
+        map();
+        // ftruncate deja el archivo lleno de ceros: todos los buckets EMPTY.
+        std::memcpy(header->magic, kMagic, sizeof(kMagic));
+        header->version = kVersion;
+        header->capacity = capacity;
+        header->count = 0;
+        header->bucketsOffset = kPageSize;
+        buckets = (Bucket*) ((char*) base + header->bucketsOffset);
+        header->tableChecksum = tableChecksum();
+        header->clean = 1;
+        header->headerChecksum = headerChecksumOf(*header);
+    }
+
+    void open(bool verify) {
+        map();
+        if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("No es un archivo de PersistentMapMonitor");
+        }
+        if (header->version != kVersion) {
+            throw std::runtime_error("Versión de archivo no soportada");
+        }
+        if (header->headerChecksum != headerChecksumOf(*header)) {
+            throw std::runtime_error("Header corrupto");
+        }
+        if (header->bucketsOffset % kPageSize != 0) {
+            throw std::runtime_error("Header corrupto");
+        }
+        if (header->bucketsOffset + header->capacity * sizeof(Bucket) > mappedSize) {
+            throw std::runtime_error("Archivo truncado");
+        }
+        if (header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0) {
+            throw std::runtime_error("Header corrupto");
+        }
+        buckets = (Bucket*) ((char*) base + header->bucketsOffset);
+        if (!header->clean) {
+            // El proceso anterior murió (o se cortó la luz) entre un cambio y un
+            // checkpoint. El kernel baja las páginas de un MAP_SHARED en cualquier
+            // orden, así que "count" y los buckets pueden no coincidir: no se puede
+            // confiar en el header, hay que reparar.
+            repair();
+            return;
+        }
+        // Verificar la tabla implica leer TODO el archivo, y eso es justamente lo
+        // que el arranque "lazy" quiere evitar. Por eso es opcional.
+        if (verify && header->tableChecksum != tableChecksum()) {
+            throw std::runtime_error("Tabla corrupta");
+        }
+    }
+
+    // Recorre TODOS los buckets: un arranque después de una caída no es lazy. Cada
+    // bucket llega a disco entero (no cruza páginas), así que alcanza con mirar su
+    // estado; uno desconocido es basura y se descarta como TOMBSTONE. La cantidad
+    // se recalcula en vez de leerla del header.
+    void repair() {
+        uint64_t count = 0;
+        for (uint64_t i = 0; i < header->capacity; ++i) {
+            if (buckets[i].state == FULL) {
+                ++count;
+            } else if (buckets[i].state != EMPTY && buckets[i].state != TOMBSTONE) {
+                buckets[i].state = TOMBSTONE;
+            }
+        }
+        header->count = count;
+    }
+
+    void map() {
+        base = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            throw systemError("mmap");
+        }
+        header = (FileHeader*) base;
+    }
+
+public:
+    // Abre el archivo si existe (la capacidad es la del archivo) o lo crea.
+    PersistentMapMonitor(const char *path, uint64_t capacity, bool verify = false) :
+        fd(-1), mappedSize(0), base(MAP_FAILED), header(NULL), buckets(NULL) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("La capacidad tiene que ser potencia de 2");
+        }
+        fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw systemError("open");
+        }
+        try {
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                throw systemError("fstat");
+            }
+            if (st.st_size == 0) {
+                create(capacity);
+            } else {
+                mappedSize = st.st_size;
+                open(verify);
+            }
+        } catch (...) {
+            // El destructor no corre si el constructor falla: RAII a mano.
+            if (base != MAP_FAILED) {
+                munmap(base, mappedSize);
+            }
+            close(fd);
+            throw;
+        }
+    }
+
+    PersistentMapMonitor(const PersistentMapMonitor&) = delete;
+    PersistentMapMonitor& operator=(const PersistentMapMonitor&) = delete;
+
+    void putIfAbsent(int key, int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Bucket *bucket = probe(key, true);
+        if (bucket == NULL) {
+            throw std::length_error("PersistentMapMonitor lleno");
+        }
+        if (bucket->state != FULL) {
+            markDirty();
+            bucket->key = key;
+            bucket->value = value;
+            // Que el compilador no adelante el FULL: si la página baja a disco en
+            // el medio, tiene que verse el bucket viejo, no uno FULL con basura.
+            std::atomic_signal_fence(std::memory_order_release);
+            bucket->state = FULL;
+            header->count++;
+        }
+    }
+
+    void printIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Bucket *bucket = probe(key, false);
+        if (bucket != NULL) {
+            std::cout << "Par rescatado! (" << key << ", " << bucket->value << ")" << std::endl;
+        }
+    }
+
+    void removeIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Bucket *bucket = probe(key, false);
+        if (bucket != NULL) {
+            markDirty();
+            bucket->state = TOMBSTONE;
+            header->count--;
+        }
+    }
+
+    uint64_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return header->count;
+    }
+
+    // Un checkpoint deja el archivo consistente en disco: primero los buckets, y
+    // recién después el header que dice "estoy limpio".
+    void checkpoint() {
+        std::lock_guard<std::mutex> lock(mutex);
+        header->tableChecksum = tableChecksum();
+        if (msync(base, mappedSize, MS_SYNC) != 0) {
+            throw systemError("msync");
+        }
+        header->clean = 1;
+        header->headerChecksum = headerChecksumOf(*header);
+        if (msync(base, sizeof(FileHeader), MS_SYNC) != 0) {
+            throw systemError("msync");
+        }
+    }
+
+    bool wasCleanlyCheckpointed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return header->clean == 1;
+    }
+
+    ~PersistentMapMonitor() {
+        munmap(base, mappedSize);
+        close(fd);
+    }
+};
+
+void usingThePersistentMonitor() {
+    const char *path = "paso13.map";
+    std::remove(path);
+
+    // Primera ejecución: construimos el mapa "a mano" y hacemos un checkpoint.
+    {
+        PersistentMapMonitor map(path, 1 << 20);
+        std::thread filler_thread([&] {
+            for (int key = 0; key < 100000; ++key) {
+                map.putIfAbsent(key, key);
+            }
+        });
+        filler_thread.join();
+        map.checkpoint();
+    }
+
+    // Segunda ejecución: reabrir es mapear el archivo.
+    auto start = std::chrono::steady_clock::now();
+    PersistentMapMonitor map(path, 1 << 20);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Reabierto en "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+              << "us con " << map.size() << " entradas (limpio: "
+              << map.wasCleanlyCheckpointed() << ")" << std::endl;
+
+    std::thread remover_thread([&] {
+        for (int key = 0; key < 100; ++key) {
+            map.removeIfPresent(key);
+        }
+    });
+
+    std::thread printer_thread([&] {
+        for (int key = 104; key >= 95; --key) {
+            map.printIfPresent(key);
+        }
+    });
+
+    printer_thread.join();
+    remover_thread.join();
+
+    std::remove(path);
+}
+
+int main(int argc, char const *argv[]) {
+    try {
+        usingThePersistentMonitor();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Nada de punteros adentro del archivo: offsets e índices. Un puntero guardado
+//    hoy no significa nada en la próxima ejecución.
+// 2. MAP_SHARED hace que los cambios lleguen al page cache del kernel, así que
+//    sobreviven a que el proceso muera. Para sobrevivir a que se corte la luz,
+//    hace falta msync: eso es el checkpoint.
+// 3. El orden importa en las dos direcciones: el checkpoint baja primero los datos
+//    y después el header "limpio"; el primer cambio después de un checkpoint baja
+//    primero el header "sucio" y después toca los datos.
+// 4. El mutex NO vive en el archivo: la sincronización sigue siendo entre threads
+//    de un mismo proceso.
+// 5. Abrir un archivo "sucio" no es lazy: el header no es confiable, así que se
+//    recorre la tabla entera para recalcular la cantidad de entradas.
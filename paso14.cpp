@@ -0,0 +1,446 @@
+// Queremos que putIfAbsent y removeIfPresent sean durables: si la función volvió,
+// el cambio sobrevive a que se corte la luz.
+//
+// La versión ingenua hace write + fsync adentro de la critical section del paso 8.
+// Un fsync tarda milisegundos, y mientras tanto NADIE puede entrar al monitor.
+//
+// La técnica clásica es un write-ahead log con "group commit": cada thread anota
+// su cambio en una cola (barato, en memoria) y un único thread escritor junta
+// todos los registros pendientes y los baja al disco con UN solo fdatasync. Los
+// threads esperan a que su registro sea durable, pero FUERA del mutex del mapa.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/* ************************************************************************* *
+ * WAL - Registros binarios de tamaño fijo
+ * ************************************************************************* */
+
+enum LogOperation : uint32_t {
+    LOG_PUT = 1,
+    LOG_REMOVE = 2
+};
+
+// 16 bytes por registro. El checksum nos deja detectar un registro a medio
+// escribir al final del archivo (el proceso murió en el medio de un write).
+struct LogRecord {
+    uint32_t operation;
+    int32_t key;
+    int32_t value;
+    uint32_t checksum;
+
+    uint32_t computeChecksum() const {
+        uint32_t hash = 2166136261u;
+        const unsigned char *bytes = (const unsigned char*) this;
+        for (size_t i = 0; i < offsetof(LogRecord, checksum); ++i) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    static LogRecord make(LogOperation operation, int key, int value) {
+        LogRecord record;
+        record.operation = operation;
+        record.key = key;
+        record.value = value;
+        record.checksum = record.computeChecksum();
+        return record;
+    }
+};
+
+static_assert(sizeof(LogRecord) == 16, "Los registros tienen que tener siempre el mismo layout");
+
+static std::runtime_error systemError(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Crear o renombrar un archivo cambia el DIRECTORIO, no el archivo: el fdatasync
+// del archivo no lo cubre. Hasta que no se sincroniza el directorio, un corte de
+// luz puede hacer que la entrada nueva (o el rename) desaparezca.
+static void syncDirectoryOf(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." :
+                            slash == 0 ? "/" : path.substr(0, slash);
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0) {
+        throw systemError("open " + directory);
+    }
+    int result = fsync(dirFd);
+    int savedErrno = errno;
+    close(dirFd);
+    if (result != 0) {
+        errno = savedErrno;
+        throw systemError("fsync " + directory);
+    }
+}
+
+static void writeAll(int fd, const void *data, size_t size) {
+    const char *bytes = (const char*) data;
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw systemError("write");
+        }
+        bytes += written;
+        size -= written;
+    }
+}
+
+/* ************************************************************************* *
+ * MONITOR - Mapa durable con group commit
+ * ************************************************************************* */
+
+struct GroupCommitOptions {
+    // Cuánto puede esperar el primer registro de un lote antes de bajar a disco.
+    std::chrono::microseconds maxLatency;
+    // Con cuántos registros pendientes bajamos a disco sin esperar más.
+    size_t maxBatch;
+
+    GroupCommitOptions() : maxLatency(2000), maxBatch(256) {}
+};
+
+class DurableMapMonitor {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // El mapa y su mutex, como en el paso 8.
+    std::map<int, int> internal;
+    std::mutex mutex;
+
+    // La cola del log tiene su PROPIO mutex: encolar no compite con el fsync.
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::condition_variable durableReached;
+    std::vector<LogRecord> pending;
+    Clock::time_point firstPendingAt;
+    uint64_t lastEnqueued;
+    uint64_t lastDurable;
+    uint64_t recordsWritten;
+    uint64_t fsyncs;
+    std::string writerError;
+    bool keepWriting;
+
+    // Lo toma el escritor mientras usa el fd, y la compactación para cambiarlo.
+    std::mutex ioMutex;
+    const std::string path;
+    int fd;
+
+    const GroupCommitOptions options;
+    std::thread writer;
+
+    bool contains(int key) {
+        return internal.find(key) != internal.end();
+    }
+
+    // Se llama con el mutex del mapa tomado: así el orden del log es el mismo
+    // orden en el que se aplicaron los cambios.
+    uint64_t enqueue(const LogRecord &record) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (pending.empty()) {
+            firstPendingAt = Clock::now();
+            queueReady.notify_one();
+        }
+        pending.push_back(record);
+        if (pending.size() == options.maxBatch) {
+            queueReady.notify_one();
+        }
+        return ++lastEnqueued;
+    }
+
+    uint64_t lastEnqueuedSequence() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return lastEnqueued;
+    }
+
+    // Se llama SIN el mutex del mapa: acá es donde se "paga" el fsync.
+    void waitDurable(uint64_t sequence) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        durableReached.wait(lock, [&] {
+            return lastDurable >= sequence || !writerError.empty();
+        });
+        if (lastDurable < sequence) {
+            throw std::runtime_error("WAL: " + writerError);
+        }
+    }
+
+    void writeLoop() {
+        std::vector<LogRecord> batch;
+        std::unique_lock<std::mutex> lock(queueMutex);
+        for (;;) {
+            queueReady.wait(lock, [&] { return !keepWriting || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            // Esperamos a juntar un lote, pero nunca más que maxLatency desde
+            // el primer registro pendiente.
+            queueReady.wait_until(lock, firstPendingAt + options.maxLatency, [&] {
+                return !keepWriting || pending.size() >= options.maxBatch;
+            });
+            batch.swap(pending);
+            uint64_t upTo = lastEnqueued;
+            lock.unlock();
+
+            std::string error;
+            try {
+                std::lock_guard<std::mutex> io(ioMutex);
+                writeAll(fd, batch.data(), batch.size() * sizeof(LogRecord));
+                if (fdatasync(fd) != 0) {
+                    throw systemError("fdatasync");
+                }
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+
+            lock.lock();
+            if (!error.empty()) {
+                writerError = error;
+                durableReached.notify_all();
+                return;
+            }
+            lastDurable = upTo;
+            recordsWritten += batch.size();
+            ++fsyncs;
+            batch.clear();
+            durableReached.notify_all();
+        }
+    }
+
+    // Aplica el log existente. Un registro inválido marca el final: todo lo que
+    // sigue es basura de una escritura que no terminó, y se trunca.
+    void replay() {
+        off_t validBytes = 0;
+        LogRecord record;
+        for (;;) {
+            ssize_t n = pread(fd, &record, sizeof(record), validBytes);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n != (ssize_t) sizeof(record) || record.checksum != record.computeChecksum()) {
+                break;
+            }
+            if (record.operation == LOG_PUT) {
+                internal[record.key] = record.value;
+            } else if (record.operation == LOG_REMOVE) {
+                internal.erase(record.key);
+            }
+            validBytes += sizeof(record);
+        }
+        if (ftruncate(fd, validBytes) != 0) {
+            throw systemError("ftruncate");
+        }
+        if (lseek(fd, validBytes, SEEK_SET) < 0) {
+            throw systemError("lseek");
+        }
+    }
+
+public:
+    explicit DurableMapMonitor(const std::string &path,
+                               const GroupCommitOptions &options = GroupCommitOptions()) :
+        lastEnqueued(0), lastDurable(0), recordsWritten(0), fsyncs(0), keepWriting(true),
+        path(path), fd(-1), options(options) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw systemError("open");
+        }
+        try {
+            // Si el log se acaba de crear, que su entrada en el directorio también
+            // sea durable antes de aceptar el primer cambio.
+            syncDirectoryOf(path);
+            replay();
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        // El escritor arranca recién cuando el estado ya está reconstruido.
+        writer = std::thread(&DurableMapMonitor::writeLoop, this);
+    }
+
+    DurableMapMonitor(const DurableMapMonitor&) = delete;
+    DurableMapMonitor& operator=(const DurableMapMonitor&) = delete;
+
+    void putIfAbsent(int key, int value) {
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!contains(key)) {
+                internal[key] = value;
+                sequence = enqueue(LogRecord::make(LOG_PUT, key, value));
+            } else {
+                // No cambiamos nada, pero el estado que vimos también tiene que
+                // ser durable antes de volver.
+                sequence = lastEnqueuedSequence();
+            }
+        }
+        waitDurable(sequence);
+    }
+
+    void printIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (contains(key)) {
+            std::cout << "Par rescatado! (" << key << ", " << internal.at(key) << ")" << std::endl;
+        }
+    }
+
+    void removeIfPresent(int key) {
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (contains(key)) {
+                internal.erase(key);
+                sequence = enqueue(LogRecord::make(LOG_REMOVE, key, 0));
+            } else {
+                sequence = lastEnqueuedSequence();
+            }
+        }
+        waitDurable(sequence);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return internal.size();
+    }
+
+    // El log crece con cada cambio, aunque el mapa no crezca. Compactar es escribir
+    // un log nuevo con un PUT por cada entrada viva y reemplazar el viejo con
+    // rename, que es atómico.
+    void compact() {
+        // Con el mutex del mapa tomado no entran cambios nuevos...
+        std::lock_guard<std::mutex> lock(mutex);
+        // ...y esperamos a que el escritor baje los que ya estaban encolados.
+        waitDurable(lastEnqueuedSequence());
+
+        std::string tmpPath = path + ".compact";
+        int tmp = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (tmp < 0) {
+            throw systemError("open");
+        }
+        try {
+            std::vector<LogRecord> snapshot;
+            snapshot.reserve(internal.size());
+            for (auto it = internal.begin(); it != internal.end(); ++it) {
+                snapshot.push_back(LogRecord::make(LOG_PUT, it->first, it->second));
+            }
+            writeAll(tmp, snapshot.data(), snapshot.size() * sizeof(LogRecord));
+            if (fdatasync(tmp) != 0) {
+                throw systemError("fdatasync");
+            }
+            if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+                throw systemError("rename");
+            }
+        } catch (...) {
+            close(tmp);
+            throw;
+        }
+
+        // Desde que rename volvió, el log viejo ya no tiene nombre: todo lo que se
+        // siga escribiendo ahí se pierde al reiniciar. El cambio de fd no puede
+        // depender de nada que pueda fallar.
+        {
+            std::lock_guard<std::mutex> io(ioMutex);
+            close(fd);
+            fd = tmp;
+        }
+        // Sin esto, después de un corte de luz el nombre puede volver a apuntar al
+        // log viejo. Si falla, el log nuevo ya está en uso: solo lo reportamos.
+        syncDirectoryOf(path);
+    }
+
+    // Cuántos registros bajamos a disco por cada fdatasync: la métrica que dice
+    // si el group commit está funcionando.
+    double recordsPerFsync() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        return fsyncs == 0 ? 0.0 : double(recordsWritten) / fsyncs;
+    }
+
+    ~DurableMapMonitor() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            keepWriting = false;
+        }
+        queueReady.notify_all();
+        writer.join();
+        close(fd);
+    }
+};
+
+void usingTheDurableMonitor() {
+    const char *path = "paso14.wal";
+    std::remove(path);
+
+    {
+        DurableMapMonitor map(path);
+
+        // Muchos threads mutando a la vez: es justamente cuando el group commit
+        // junta lotes grandes.
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 8; ++t) {
+            writers.push_back(std::thread([&map, t] {
+                for (int key = t * 250; key < (t + 1) * 250; ++key) {
+                    map.putIfAbsent(key, key);
+                }
+                for (int key = t * 250; key < (t + 1) * 250; key += 2) {
+                    map.removeIfPresent(key);
+                }
+            }));
+        }
+        for (size_t i = 0; i < writers.size(); ++i) {
+            writers[i].join();
+        }
+        std::cout << "Registros por fdatasync: " << map.recordsPerFsync() << std::endl;
+    }
+
+    // "Reiniciamos": el estado se reconstruye leyendo el log.
+    {
+        DurableMapMonitor map(path);
+        std::cout << "Reconstruido con " << map.size() << " entradas" << std::endl;
+        map.compact();
+    }
+
+    DurableMapMonitor map(path);
+    std::cout << "Después de compactar: " << map.size() << " entradas" << std::endl;
+    for (int key = 5; key >= 0; --key) {
+        map.printIfPresent(key);
+    }
+
+    std::remove(path);
+}
+
+int main(int argc, char const *argv[]) {
+    try {
+        usingTheDurableMonitor();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Encolar pasa adentro de la critical section del mapa (así el log respeta el
+//    orden de los cambios), pero ESPERAR el fsync pasa afuera.
+// 2. maxLatency y maxBatch son el compromiso entre latencia y throughput: un lote
+//    más grande amortiza mejor el fdatasync, pero el primer thread espera más.
+// 3. Un registro con checksum inválido al final del log no es un error: es la
+//    escritura que no terminó cuando se cayó el proceso. Se trunca y listo.
+// 4. Los registros se guardan en el endianness de la máquina: el log no es
+//    portable entre arquitecturas.
+// 5. Crear un archivo o hacer rename es durable recién cuando se hace fsync del
+//    directorio que lo contiene, no del archivo.
@@ -0,0 +1,341 @@
+// El wrapper de Mutex del paso 9 siempre le pasa NULL como atributo a
+// pthread_mutex_init. Eso lo deja andando solamente entre threads de UN proceso.
+//
+// Si tenemos varios procesos en la misma máquina que comparten estado, en vez de
+// mandarlo por pipes (serializar, copiar, deserializar) podemos poner el estado
+// en memoria compartida POSIX (shm_open + mmap) junto con un mutex marcado como
+// PTHREAD_PROCESS_SHARED.
+//
+// Aparece un problema nuevo: un proceso puede morir con el mutex tomado. Entre
+// threads eso no pasa (si muere un thread muere el proceso), pero entre procesos
+// sí. Para eso están los mutex "robustos".
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* ************************************************************************* *
+ * MUTEX - Compartido entre procesos y robusto
+ * ************************************************************************* */
+
+// Como el Mutex del paso 9, pero pensado para vivir ADENTRO de la memoria
+// compartida. Por eso no tiene punteros ni referencias a nada del proceso.
+class SharedMutex {
+private:
+    pthread_mutex_t c_mutex;
+
+public:
+    SharedMutex() {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        int error = pthread_mutex_init(&c_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        if (error != 0) {
+            throw std::runtime_error(std::string("pthread_mutex_init: ") + std::strerror(error));
+        }
+    }
+
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+
+    // Devuelve true si el dueño anterior murió con el mutex tomado. En ese caso
+    // lo tenemos NOSOTROS, pero el estado protegido puede haber quedado a medio
+    // modificar: quien llama tiene que repararlo y después llamar a consistent().
+    bool lock() {
+        int error = pthread_mutex_lock(&c_mutex);
+        if (error == EOWNERDEAD) {
+            return true;
+        }
+        if (error != 0) {
+            throw std::runtime_error(std::string("pthread_mutex_lock: ") + std::strerror(error));
+        }
+        return false;
+    }
+
+    void consistent() {
+        pthread_mutex_consistent(&c_mutex);
+    }
+
+    void unlock() {
+        pthread_mutex_unlock(&c_mutex);
+    }
+
+    ~SharedMutex() {
+        pthread_mutex_destroy(&c_mutex);
+    }
+};
+
+/* ************************************************************************* *
+ * MONITOR - Un MapMonitor que vive entero en el segmento compartido
+ * ************************************************************************* */
+
+// Nada de std::map acá: sus nodos viven en el heap de UN proceso. La tabla es un
+// arreglo de tamaño fijo con linear probing, y todo está adentro del objeto.
+class SharedMapMonitor {
+private:
+    static const uint32_t kCapacity = 1024;
+
+    enum : uint32_t {
+        EMPTY = 0,
+        FULL = 1,
+        TOMBSTONE = 2
+    };
+
+    // El estado es atómico para que el compilador no pueda reordenar ni eliminar
+    // el store que publica el bucket: es lo único que ve quien hereda el mutex de
+    // un proceso muerto.
+    struct Bucket {
+        int32_t key;
+        int32_t value;
+        std::atomic<uint32_t> state;
+    };
+
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "El estado tiene que ser lock-free entre procesos");
+
+    SharedMutex mutex;
+    uint32_t count;
+    Bucket buckets[kCapacity];
+
+    // Lock RAII que además repara el monitor si el dueño anterior murió.
+    class Guard {
+    private:
+        SharedMapMonitor &monitor;
+
+    public:
+        explicit Guard(SharedMapMonitor &monitor) : monitor(monitor) {
+            if (monitor.mutex.lock()) {
+                monitor.recover();
+                monitor.mutex.consistent();
+            }
+        }
+
+        ~Guard() {
+            monitor.mutex.unlock();
+        }
+    };
+
+    // Cada cambio a un bucket es UN store de su estado, así que los buckets
+    // siempre quedan enteros. Lo único que puede haber quedado a medias es count.
+    void recover() {
+        count = 0;
+        for (uint32_t i = 0; i < kCapacity; ++i) {
+            if (buckets[i].state.load(std::memory_order_relaxed) == FULL) {
+                ++count;
+            }
+        }
+    }
+
+    Bucket *probe(int key, bool forInsert) {
+        uint32_t i = (uint32_t(key) * 2654435761u) % kCapacity;
+        Bucket *firstFree = NULL;
+        for (uint32_t n = 0; n < kCapacity; ++n, i = (i + 1) % kCapacity) {
+            Bucket &bucket = buckets[i];
+            uint32_t state = bucket.state.load(std::memory_order_relaxed);
+            if (state == FULL && bucket.key == key) {
+                return &bucket;
+            }
+            if (state != FULL && firstFree == NULL) {
+                firstFree = &bucket;
+            }
+            if (state == EMPTY) {
+                break;
+            }
+        }
+        return forInsert ? firstFree : NULL;
+    }
+
+public:
+    // Nada de memset sobre un std::atomic: cada bucket se inicializa con su store.
+    SharedMapMonitor() : count(0) {
+        for (uint32_t i = 0; i < kCapacity; ++i) {
+            buckets[i].key = 0;
+            buckets[i].value = 0;
+            buckets[i].state.store(EMPTY, std::memory_order_relaxed);
+        }
+    }
+
+    SharedMapMonitor(const SharedMapMonitor&) = delete;
+    SharedMapMonitor& operator=(const SharedMapMonitor&) = delete;
+
+    void putIfAbsent(int key, int value) {
+        Guard guard(*this);
+        Bucket *bucket = probe(key, true);
+        if (bucket == NULL) {
+            throw std::length_error("SharedMapMonitor lleno");
+        }
+        if (bucket->state.load(std::memory_order_relaxed) != FULL) {
+            // Mientras el estado no diga FULL, el bucket sigue libre: si morimos
+            // acá, la clave y el valor a medio escribir se ignoran.
+            bucket->key = key;
+            bucket->value = value;
+            // El release impide que los stores de arriba queden después de este.
+            bucket->state.store(FULL, std::memory_order_release);
+            ++count;
+        }
+    }
+
+    void printIfPresent(int key) {
+        Guard guard(*this);
+        Bucket *bucket = probe(key, false);
+        if (bucket != NULL) {
+            std::cout << "[" << getpid() << "] Par rescatado! (" << key << ", "
+                      << bucket->value << ")" << std::endl;
+        }
+    }
+
+    void removeIfPresent(int key) {
+        Guard guard(*this);
+        Bucket *bucket = probe(key, false);
+        if (bucket != NULL) {
+            bucket->state.store(TOMBSTONE, std::memory_order_release);
+            --count;
+        }
+    }
+
+    uint32_t size() {
+        Guard guard(*this);
+        return count;
+    }
+
+    // Solo para la demo: toma el mutex y NO lo suelta, como un proceso que muere
+    // en el medio de una critical section.
+    void lockAndDie() {
+        mutex.lock();
+        _exit(0);
+    }
+};
+
+/* ************************************************************************* *
+ * SHARED MEMORY - RAII sobre shm_open + mmap
+ * ************************************************************************* */
+
+// El proceso que crea el segmento construye el objeto con placement new; los
+// demás (o los hijos de un fork) solamente lo mapean.
+template <class T>
+class SharedSegment {
+private:
+    std::string name;
+    bool owner;
+    T *object;
+
+public:
+    SharedSegment(const std::string &name, bool create) : name(name), owner(create), object(NULL) {
+        int flags = create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR;
+        int fd = shm_open(name.c_str(), flags, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("shm_open: " + std::string(std::strerror(errno)));
+        }
+        if (create && ftruncate(fd, sizeof(T)) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("ftruncate: " + std::string(std::strerror(errno)));
+        }
+        void *address = mmap(NULL, sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        // El mapeo sobrevive al close del fd.
+        close(fd);
+        if (address == MAP_FAILED) {
+            if (create) {
+                shm_unlink(name.c_str());
+            }
+            throw std::runtime_error("mmap: " + std::string(std::strerror(errno)));
+        }
+        object = create ? new (address) T() : (T*) address;
+    }
+
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+
+    T &get() {
+        return *object;
+    }
+
+    ~SharedSegment() {
+        if (owner) {
+            object->~T();
+            shm_unlink(name.c_str());
+        }
+        munmap(object, sizeof(T));
+    }
+};
+
+void usingTheSharedMonitor() {
+    SharedSegment<SharedMapMonitor> segment("/paso15_map", true);
+    SharedMapMonitor &map = segment.get();
+    for (int key = 0; key < 100; ++key) {
+        map.putIfAbsent(key, key);
+    }
+
+    // Ahora los "threads" son procesos. Después del fork, el segmento sigue
+    // mapeado en el hijo y apunta a LA MISMA memoria física.
+    pid_t remover = fork();
+    if (remover == 0) {
+        for (int key = 0; key < 100; ++key) {
+            map.removeIfPresent(key);
+        }
+        _exit(0);
+    }
+
+    pid_t printer = fork();
+    if (printer == 0) {
+        for (int key = 99; key >= 0; --key) {
+            map.printIfPresent(key);
+        }
+        _exit(0);
+    }
+
+    // You fork a process, you wait a process.
+    waitpid(printer, NULL, 0);
+    waitpid(remover, NULL, 0);
+    std::cout << "Quedan " << map.size() << " entradas" << std::endl;
+
+    // Un proceso muere con el mutex tomado. Sin un mutex robusto, el próximo lock
+    // sería un deadlock para siempre.
+    pid_t dying = fork();
+    if (dying == 0) {
+        map.lockAndDie();
+    }
+    waitpid(dying, NULL, 0);
+
+    map.putIfAbsent(7, 7);
+    map.printIfPresent(7);
+}
+
+int main(int argc, char const *argv[]) {
+    try {
+        usingTheSharedMonitor();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Todo lo que vive en memoria compartida tiene que tener layout fijo y CERO
+//    punteros: cada proceso puede mapear el segmento en otra dirección.
+// 2. PTHREAD_PROCESS_SHARED es lo que permite que el mutex funcione desde varios
+//    procesos. Sin eso, el comportamiento es indefinido.
+// 3. Un mutex robusto no "arregla" el estado: solamente nos avisa (EOWNERDEAD) que
+//    hay que repararlo. Por eso cada inserción escribe clave y valor, y recién
+//    DESPUÉS publica el bucket con un único store atómico (release) del estado.
+//    Con stores comunes, el compilador podría adelantar el FULL o eliminar una
+//    marca intermedia, y el que recupera vería un bucket FULL con basura.
+// 4. shm_unlink borra el nombre, pero la memoria vive hasta que el último proceso
+//    la desmapee. Igual que un archivo abierto al que le hicieron unlink.
+// 5. std::atomic en memoria compartida solo sirve si es lock-free: si no, el lock
+//    interno vive en el proceso y no protege nada entre procesos.
+// 6. Con glibc viejas puede hacer falta linkear con -lrt para shm_open.
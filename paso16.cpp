@@ -0,0 +1,329 @@
+// Aunque el MapMonitor del paso 8 tenga buenas critical sections, sigue habiendo
+// UN mutex y UN std::map que todos los cores tocan. Las líneas de cache del mutex
+// y de los nodos del árbol "rebotan" de un core a otro en cada operación.
+//
+// Cambiemos de enfoque: en vez de compartir el mapa y sincronizar el acceso, NO
+// lo compartimos. Partimos las claves en particiones, y cada partición tiene un
+// único thread dueño (fijado a un core) que es el único que toca su std::map.
+// Los demás threads le mandan mensajes por una cola lock-free y reciben la
+// respuesta en un std::future. Es el modelo "shared-nothing".
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+/* ************************************************************************* *
+ * MPSC - Cola lock-free de muchos productores y un consumidor
+ * ************************************************************************* */
+
+struct QueueNode {
+    std::atomic<QueueNode*> next;
+
+    QueueNode() : next(NULL) {}
+    virtual ~QueueNode() = default;
+};
+
+// La cola de Dmitry Vyukov: un productor encola con UN exchange atómico, sin
+// loops de CAS. El consumidor no usa atómicos costosos, solo loads.
+class MpscQueue {
+private:
+    std::atomic<QueueNode*> head;  // la tocan los productores
+    QueueNode *tail;               // la toca solamente el consumidor
+    QueueNode stub;
+
+public:
+    MpscQueue() : head(&stub), tail(&stub) {}
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Encola una cadena first -> ... -> last ya enlazada. Una tanda entera cuesta
+    // lo mismo que un solo nodo: un exchange.
+    void push(QueueNode *first, QueueNode *last) {
+        last->next.store(NULL, std::memory_order_relaxed);
+        QueueNode *previous = head.exchange(last, std::memory_order_acq_rel);
+        previous->next.store(first, std::memory_order_release);
+    }
+
+    void push(QueueNode *node) {
+        push(node, node);
+    }
+
+    // Devuelve NULL si la cola está vacía, o si un productor está a mitad de un
+    // push (en ese caso el nodo aparece en el próximo intento).
+    QueueNode *pop() {
+        QueueNode *current = tail;
+        QueueNode *next = current->next.load(std::memory_order_acquire);
+        if (current == &stub) {
+            if (next == NULL) {
+                return NULL;
+            }
+            tail = next;
+            current = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != NULL) {
+            tail = next;
+            return current;
+        }
+        if (current != head.load(std::memory_order_acquire)) {
+            return NULL;
+        }
+        push(&stub);
+        next = current->next.load(std::memory_order_acquire);
+        if (next != NULL) {
+            tail = next;
+            return current;
+        }
+        return NULL;
+    }
+};
+
+/* ************************************************************************* *
+ * PARTICIONES - Un dueño por partición, sin locks en el camino de los datos
+ * ************************************************************************* */
+
+struct MapResult {
+    bool ok;    // put: se insertó; remove: se borró; get: se encontró
+    int value;  // solo para get
+};
+
+enum MapOperation {
+    MAP_PUT_IF_ABSENT,
+    MAP_REMOVE_IF_PRESENT,
+    MAP_GET
+};
+
+struct MapRequest: public QueueNode {
+    MapOperation operation;
+    int key;
+    int value;
+    std::promise<MapResult> result;
+
+    MapRequest(MapOperation operation, int key, int value) :
+        operation(operation), key(key), value(value) {
+    }
+};
+
+class Partition {
+private:
+    // Solo el thread dueño toca "internal". No hay mutex porque no hace falta.
+    std::map<int, int> internal;
+    MpscQueue inbox;
+    std::atomic<bool> running;
+    std::thread owner;
+
+    MapResult apply(const MapRequest &request) {
+        MapResult result = {false, 0};
+        switch (request.operation) {
+        case MAP_PUT_IF_ABSENT:
+            result.ok = internal.insert(std::make_pair(request.key, request.value)).second;
+            break;
+        case MAP_REMOVE_IF_PRESENT:
+            result.ok = internal.erase(request.key) == 1;
+            break;
+        case MAP_GET: {
+            auto it = internal.find(request.key);
+            if (it != internal.end()) {
+                result.ok = true;
+                result.value = it->second;
+            }
+            break;
+        }
+        }
+        return result;
+    }
+
+    void serve() {
+        int idle = 0;
+        for (;;) {
+            QueueNode *node = inbox.pop();
+            if (node == NULL) {
+                if (!running.load(std::memory_order_acquire)) {
+                    return;
+                }
+                // Sin trabajo: primero giramos, después cedemos el core, y si
+                // sigue sin haber nada dormimos un poquito.
+                ++idle;
+                if (idle > 1000) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                } else if (idle > 100) {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+            idle = 0;
+            MapRequest *request = static_cast<MapRequest*>(node);
+            request->result.set_value(apply(*request));
+            delete request;
+        }
+    }
+
+public:
+    explicit Partition(int core) : running(true), owner(&Partition::serve, this) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core, &cpus);
+        // Si no se puede fijar (por ejemplo, en un contenedor con menos cores),
+        // sigue andando igual: es una optimización, no un requisito.
+        pthread_setaffinity_np(owner.native_handle(), sizeof(cpus), &cpus);
+    }
+
+    Partition(const Partition&) = delete;
+    Partition& operator=(const Partition&) = delete;
+
+    void submit(MapRequest *first, MapRequest *last) {
+        inbox.push(first, last);
+    }
+
+    ~Partition() {
+        // El dueño vacía la cola antes de terminar: ninguna promesa queda sin
+        // cumplir.
+        running.store(false, std::memory_order_release);
+        owner.join();
+    }
+};
+
+class PartitionedMap {
+private:
+    std::vector<Partition*> partitions;
+
+    size_t partitionOf(int key) const {
+        return (unsigned(key) * 2654435761u) % partitions.size();
+    }
+
+    std::future<MapResult> submit(MapOperation operation, int key, int value) {
+        MapRequest *request = new MapRequest(operation, key, value);
+        std::future<MapResult> result = request->result.get_future();
+        partitions[partitionOf(key)]->submit(request, request);
+        return result;
+    }
+
+public:
+    explicit PartitionedMap(size_t count = std::thread::hardware_concurrency()) {
+        if (count == 0) {
+            count = 1;
+        }
+        unsigned cores = std::thread::hardware_concurrency();
+        for (size_t i = 0; i < count; ++i) {
+            partitions.push_back(new Partition(cores == 0 ? 0 : i % cores));
+        }
+    }
+
+    PartitionedMap(const PartitionedMap&) = delete;
+    PartitionedMap& operator=(const PartitionedMap&) = delete;
+
+    std::future<MapResult> putIfAbsent(int key, int value) {
+        return submit(MAP_PUT_IF_ABSENT, key, value);
+    }
+
+    std::future<MapResult> removeIfPresent(int key) {
+        return submit(MAP_REMOVE_IF_PRESENT, key, 0);
+    }
+
+    std::future<MapResult> get(int key) {
+        return submit(MAP_GET, key, 0);
+    }
+
+    // Imprimir lo hace quien pregunta, no el dueño: así los dueños no compiten
+    // por std::cout.
+    void printIfPresent(int key) {
+        MapResult result = get(key).get();
+        if (result.ok) {
+            std::cout << "Par rescatado! (" << key << ", " << result.value << ")" << std::endl;
+        }
+    }
+
+    // Envío por tandas: agrupamos por partición, enlazamos cada grupo y lo
+    // encolamos con un único exchange por partición.
+    std::vector<std::future<MapResult>> putAllIfAbsent(const std::vector<std::pair<int, int>> &pairs) {
+        std::vector<std::future<MapResult>> results;
+        results.reserve(pairs.size());
+        std::vector<MapRequest*> first(partitions.size(), NULL);
+        std::vector<MapRequest*> last(partitions.size(), NULL);
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            MapRequest *request = new MapRequest(MAP_PUT_IF_ABSENT, pairs[i].first, pairs[i].second);
+            results.push_back(request->result.get_future());
+            size_t p = partitionOf(pairs[i].first);
+            if (first[p] == NULL) {
+                first[p] = request;
+            } else {
+                last[p]->next.store(request, std::memory_order_relaxed);
+            }
+            last[p] = request;
+        }
+        for (size_t p = 0; p < partitions.size(); ++p) {
+            if (first[p] != NULL) {
+                partitions[p]->submit(first[p], last[p]);
+            }
+        }
+        return results;
+    }
+
+    ~PartitionedMap() {
+        for (size_t i = 0; i < partitions.size(); ++i) {
+            delete partitions[i];
+        }
+    }
+};
+
+void usingThePartitionedMap() {
+    PartitionedMap map(4);
+
+    std::vector<std::pair<int, int>> pairs;
+    for (int key = 0; key < 100; ++key) {
+        pairs.push_back(std::make_pair(key, key));
+    }
+    // Esperamos todas las respuestas: después de esto, las 100 claves están.
+    std::vector<std::future<MapResult>> loaded = map.putAllIfAbsent(pairs);
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        loaded[i].wait();
+    }
+
+    std::thread remover_thread([&] {
+        // Disparamos todos los pedidos sin esperar, y recién después juntamos las
+        // respuestas: el remover no se bloquea en cada operación.
+        std::vector<std::future<MapResult>> removed;
+        for (int key = 0; key < 100; ++key) {
+            removed.push_back(map.removeIfPresent(key));
+        }
+        int count = 0;
+        for (size_t i = 0; i < removed.size(); ++i) {
+            count += removed[i].get().ok;
+        }
+        std::cout << "Removidas: " << count << std::endl;
+    });
+
+    std::thread printer_thread([&] {
+        for (int key = 99; key >= 0; --key) {
+            map.printIfPresent(key);
+        }
+    });
+
+    printer_thread.join();
+    remover_thread.join();
+}
+
+int main(int argc, char const *argv[]) {
+    usingThePartitionedMap();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. No hay mutex en el camino de los datos: cada std::map tiene un único thread
+//    que lo toca. La sincronización pasó a ser el paso de mensajes.
+// 2. La cola MPSC es lock-free para los productores (un exchange) y el consumidor
+//    nunca hace CAS. Cada pedido igual cuesta un new y un std::promise.
+// 3. Fijar cada dueño a un core (afinidad) hace que su mapa se quede en SU cache.
+// 4. Un dueño ocioso gira, cede y duerme: gastar un core girando es el precio de
+//    la latencia baja. Hay que elegir.
+// 5. Las operaciones de distintas particiones NO son atómicas entre sí. Un
+//    putIfAbsent en una partición no "ve" lo que pasa en las otras.
@@ -0,0 +1,456 @@
+// En el paso 8, ProtectedMap y MapMonitor tienen hardcodeados std::map<int, int>
+// y std::mutex. Si queremos otro compromiso (otro contenedor, otro lock, contar
+// estadísticas o no) terminamos copiando la clase entera.
+//
+// C++ tiene una herramienta para esto que no cuesta nada en tiempo de ejecución:
+// "policy-based design". El Monitor recibe por template de qué está hecho, y el
+// compilador arma exactamente esa clase. Nada de virtual, nada de ifs: lo que no
+// se usa ni siquiera se compila.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+/* ************************************************************************* *
+ * POLICIES - Contenedores
+ * ************************************************************************* */
+
+// Todos los contenedores tienen la misma interfaz mínima: find (NULL si no está),
+// insert (false si ya estaba), erase (false si no estaba) y size.
+
+template <class Key, class Value>
+class TreeContainer {
+private:
+    std::map<Key, Value> internal;
+
+public:
+    Value *find(const Key &key) {
+        auto it = internal.find(key);
+        return it == internal.end() ? NULL : &it->second;
+    }
+    bool insert(const Key &key, const Value &value) {
+        return internal.insert(std::make_pair(key, value)).second;
+    }
+    bool erase(const Key &key) {
+        return internal.erase(key) == 1;
+    }
+    size_t size() const {
+        return internal.size();
+    }
+};
+
+// Hash "plano": un único arreglo con linear probing. Sin un nodo por entrada,
+// así que recorrerlo es amigable con la cache.
+template <class Key, class Value>
+class FlatHashContainer {
+private:
+    enum State : uint8_t { EMPTY, FULL, TOMBSTONE };
+
+    struct Slot {
+        Key key;
+        Value value;
+        State state;
+
+        Slot() : key(), value(), state(EMPTY) {}
+    };
+
+    std::vector<Slot> slots;
+    size_t count;
+    size_t used;  // FULL + TOMBSTONE: es lo que alarga las búsquedas
+
+    size_t indexOf(const Key &key) const {
+        return std::hash<Key>()(key) * 11400714819323198485ULL & (slots.size() - 1);
+    }
+
+    Slot *probe(const Key &key, bool forInsert) {
+        size_t mask = slots.size() - 1;
+        Slot *firstFree = NULL;
+        for (size_t i = indexOf(key), n = 0; n < slots.size(); ++n, i = (i + 1) & mask) {
+            Slot &slot = slots[i];
+            if (slot.state == FULL && slot.key == key) {
+                return &slot;
+            }
+            if (slot.state != FULL && firstFree == NULL) {
+                firstFree = &slot;
+            }
+            if (slot.state == EMPTY) {
+                break;
+            }
+        }
+        return forInsert ? firstFree : NULL;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(slots);
+        count = used = 0;
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i].state == FULL) {
+                insert(old[i].key, old[i].value);
+            }
+        }
+    }
+
+public:
+    FlatHashContainer() : slots(16), count(0), used(0) {}
+
+    Value *find(const Key &key) {
+        Slot *slot = probe(key, false);
+        return slot == NULL ? NULL : &slot->value;
+    }
+    bool insert(const Key &key, const Value &value) {
+        // Crecemos (o limpiamos tombstones) antes de pasar el 70% de ocupación.
+        if ((used + 1) * 10 > slots.size() * 7) {
+            rehash(count * 2 >= slots.size() / 2 ? slots.size() * 2 : slots.size());
+        }
+        Slot *slot = probe(key, true);
+        if (slot->state == FULL) {
+            return false;
+        }
+        if (slot->state == EMPTY) {
+            ++used;
+        }
+        slot->key = key;
+        slot->value = value;
+        slot->state = FULL;
+        ++count;
+        return true;
+    }
+    bool erase(const Key &key) {
+        Slot *slot = probe(key, false);
+        if (slot == NULL) {
+            return false;
+        }
+        slot->state = TOMBSTONE;
+        --count;
+        return true;
+    }
+    size_t size() const {
+        return count;
+    }
+};
+
+// Arreglo denso: la clave ES el índice. Solo sirve para claves enteras en
+// [0, Capacity), pero no hay nada más rápido.
+template <class Key, class Value, size_t Capacity>
+class DenseArrayContainer {
+private:
+    std::vector<Value> values;
+    std::vector<bool> present;
+    size_t count;
+
+    bool inRange(const Key &key) const {
+        return key >= 0 && size_t(key) < Capacity;
+    }
+
+public:
+    DenseArrayContainer() : values(Capacity), present(Capacity, false), count(0) {}
+
+    Value *find(const Key &key) {
+        return inRange(key) && present[key] ? &values[key] : NULL;
+    }
+    bool insert(const Key &key, const Value &value) {
+        if (!inRange(key)) {
+            throw std::out_of_range("DenseArrayContainer: clave fuera de rango");
+        }
+        if (present[key]) {
+            return false;
+        }
+        values[key] = value;
+        present[key] = true;
+        ++count;
+        return true;
+    }
+    bool erase(const Key &key) {
+        if (!inRange(key) || !present[key]) {
+            return false;
+        }
+        present[key] = false;
+        --count;
+        return true;
+    }
+    size_t size() const {
+        return count;
+    }
+};
+
+// Los "tags" que se le pasan al Monitor. Cada uno sabe construir su contenedor
+// para un par Key/Value.
+struct Tree {
+    template <class Key, class Value>
+    using Container = TreeContainer<Key, Value>;
+};
+
+struct FlatHash {
+    template <class Key, class Value>
+    using Container = FlatHashContainer<Key, Value>;
+};
+
+template <size_t Capacity>
+struct DenseArray {
+    template <class Key, class Value>
+    using Container = DenseArrayContainer<Key, Value, Capacity>;
+};
+
+/* ************************************************************************* *
+ * POLICIES - Locks
+ * ************************************************************************* */
+
+// Todas tienen lock/unlock y lockShared/unlockShared. Las que no distinguen
+// lectores de escritores usan el mismo lock para las dos cosas.
+
+class MutexLock {
+private:
+    std::mutex mutex;
+
+public:
+    void lock() { mutex.lock(); }
+    void unlock() { mutex.unlock(); }
+    void lockShared() { mutex.lock(); }
+    void unlockShared() { mutex.unlock(); }
+};
+
+// Test-and-test-and-set: mientras está tomado giramos LEYENDO (la línea de cache
+// se queda compartida), y recién intentamos escribir cuando parece libre.
+class SpinLock {
+private:
+    std::atomic<bool> locked;
+
+public:
+    SpinLock() : locked(false) {}
+
+    void lock() {
+        for (;;) {
+            if (!locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            while (locked.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void unlock() { locked.store(false, std::memory_order_release); }
+    void lockShared() { lock(); }
+    void unlockShared() { unlock(); }
+};
+
+// En C++11 no hay std::shared_mutex, así que envolvemos pthread_rwlock como
+// hicimos con el Mutex del paso 9.
+class ReaderWriterLock {
+private:
+    pthread_rwlock_t c_rwlock;
+
+public:
+    ReaderWriterLock() { pthread_rwlock_init(&c_rwlock, NULL); }
+    ReaderWriterLock(const ReaderWriterLock&) = delete;
+    ReaderWriterLock& operator=(const ReaderWriterLock&) = delete;
+
+    void lock() { pthread_rwlock_wrlock(&c_rwlock); }
+    void unlock() { pthread_rwlock_unlock(&c_rwlock); }
+    void lockShared() { pthread_rwlock_rdlock(&c_rwlock); }
+    void unlockShared() { pthread_rwlock_unlock(&c_rwlock); }
+
+    ~ReaderWriterLock() { pthread_rwlock_destroy(&c_rwlock); }
+};
+
+// Para usar el Monitor desde un único thread: el compilador borra las llamadas.
+class NoLock {
+public:
+    void lock() {}
+    void unlock() {}
+    void lockShared() {}
+    void unlockShared() {}
+};
+
+/* ************************************************************************* *
+ * POLICIES - Estadísticas
+ * ************************************************************************* */
+
+class NoStats {
+public:
+    void hit() {}
+    void miss() {}
+    void inserted() {}
+    void removed() {}
+};
+
+class CountingStats {
+private:
+    std::atomic<unsigned long> hits;
+    std::atomic<unsigned long> misses;
+    std::atomic<unsigned long> inserts;
+    std::atomic<unsigned long> removals;
+
+public:
+    CountingStats() : hits(0), misses(0), inserts(0), removals(0) {}
+
+    void hit() { hits.fetch_add(1, std::memory_order_relaxed); }
+    void miss() { misses.fetch_add(1, std::memory_order_relaxed); }
+    void inserted() { inserts.fetch_add(1, std::memory_order_relaxed); }
+    void removed() { removals.fetch_add(1, std::memory_order_relaxed); }
+
+    void print(std::ostream &out) const {
+        out << "hits: " << hits.load() << " misses: " << misses.load()
+            << " inserts: " << inserts.load() << " removals: " << removals.load() << std::endl;
+    }
+};
+
+/* ************************************************************************* *
+ * MONITOR - Las mismas critical sections del paso 8, armadas por template
+ * ************************************************************************* */
+
+// Heredamos (en privado) de las policies de lock y estadísticas en vez de tenerlas
+// como atributos: si están vacías (NoLock, NoStats), la "empty base optimization"
+// hace que no ocupen ni un byte.
+template <class Key, class Value, class ContainerPolicy = Tree,
+          class LockPolicy = MutexLock, class StatsPolicy = NoStats>
+class Monitor : private LockPolicy, private StatsPolicy {
+private:
+    typename ContainerPolicy::template Container<Key, Value> internal;
+
+    // Los Lock RAII de siempre, uno exclusivo y uno compartido.
+    class Exclusive {
+    private:
+        LockPolicy &lock;
+    public:
+        explicit Exclusive(LockPolicy &lock) : lock(lock) { lock.lock(); }
+        ~Exclusive() { lock.unlock(); }
+    };
+
+    class Shared {
+    private:
+        LockPolicy &lock;
+    public:
+        explicit Shared(LockPolicy &lock) : lock(lock) { lock.lockShared(); }
+        ~Shared() { lock.unlockShared(); }
+    };
+
+    LockPolicy &locker() { return *this; }
+    StatsPolicy &recorder() { return *this; }
+
+public:
+    Monitor() = default;
+    Monitor(const Monitor&) = delete;
+    Monitor& operator=(const Monitor&) = delete;
+
+    void putIfAbsent(const Key &key, const Value &value) {
+        Exclusive lock(locker());
+        if (internal.insert(key, value)) {
+            recorder().inserted();
+        }
+    }
+
+    bool getIfPresent(const Key &key, Value &value) {
+        Shared lock(locker());
+        const Value *found = internal.find(key);
+        if (found == NULL) {
+            recorder().miss();
+            return false;
+        }
+        recorder().hit();
+        value = *found;
+        return true;
+    }
+
+    void printIfPresent(const Key &key) {
+        Shared lock(locker());
+        const Value *found = internal.find(key);
+        if (found == NULL) {
+            recorder().miss();
+            return;
+        }
+        recorder().hit();
+        std::cout << "Par rescatado! (" << key << ", " << *found << ")" << std::endl;
+    }
+
+    void removeIfPresent(const Key &key) {
+        Exclusive lock(locker());
+        if (internal.erase(key)) {
+            recorder().removed();
+        }
+    }
+
+    size_t size() {
+        Shared lock(locker());
+        return internal.size();
+    }
+
+    // Con NoStats devuelve un objeto vacío: no hay nada para consultar.
+    const StatsPolicy &stats() const {
+        return *this;
+    }
+};
+
+// El MapMonitor del paso 8, tal cual, pero ahora es UNA configuración posible.
+typedef Monitor<int, int> MapMonitor;
+typedef Monitor<int, int, FlatHash, SpinLock, CountingStats> FastCountedMonitor;
+typedef Monitor<int, int, DenseArray<100>, ReaderWriterLock> DenseReadMostlyMonitor;
+typedef Monitor<int, int, Tree, NoLock> SingleThreadedMonitor;
+
+// Las policies vacías no ocupan lugar: el Monitor sin lock ni estadísticas pesa lo
+// mismo que su contenedor.
+static_assert(sizeof(SingleThreadedMonitor) == sizeof(TreeContainer<int, int>),
+              "NoLock y NoStats no deberían ocupar memoria");
+
+template <class AnyMonitor>
+void bombard(AnyMonitor &map) {
+    for (int key = 0; key < 100; ++key) {
+        map.putIfAbsent(key, key);
+    }
+
+    std::thread remover_thread([&] {
+        for (int key = 0; key < 100; ++key) {
+            map.removeIfPresent(key);
+        }
+    });
+
+    std::thread printer_thread([&] {
+        for (int key = 99; key >= 0; --key) {
+            map.printIfPresent(key);
+        }
+    });
+
+    printer_thread.join();
+    remover_thread.join();
+}
+
+void usingPolicyMonitors() {
+    MapMonitor classic;
+    bombard(classic);
+
+    FastCountedMonitor counted;
+    bombard(counted);
+    counted.stats().print(std::cout);
+
+    DenseReadMostlyMonitor dense;
+    bombard(dense);
+
+    // NoLock NO se bombardea: es para cuando sabemos que hay un solo thread.
+    SingleThreadedMonitor local;
+    local.putIfAbsent(1, 1);
+    local.printIfPresent(1);
+}
+
+int main(int argc, char const *argv[]) {
+    usingPolicyMonitors();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Las policies se resuelven en compilación: cada combinación es una clase
+//    distinta, sin virtual y sin ifs en tiempo de ejecución.
+// 2. El costo es tiempo de compilación y tamaño del binario: cada combinación
+//    usada genera su propio código.
+// 3. Con un ReaderWriterLock, printIfPresent y getIfPresent pueden correr en
+//    paralelo. Con MutexLock o SpinLock, lockShared es simplemente lock.
+// 4. Un Monitor con NoLock deja de ser un Monitor: es la misma interfaz, sin
+//    garantías entre threads. Usarlo desde varios threads es una race condition.
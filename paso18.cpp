@@ -0,0 +1,283 @@
+// En el paso 8 llenamos el monitor con un loop de map.putIfAbsent(key, key). Con
+// 100 claves no importa, pero con millones son millones de locks y millones de
+// búsquedas en el árbol, una por una.
+//
+// Si tenemos TODOS los pares de antemano, podemos hacer algo mucho mejor:
+// ordenarlos y sacar duplicados en paralelo, y después construir el std::map de
+// una sola pasada. Mientras el monitor se está construyendo nadie más lo ve, así
+// que no hace falta ningún lock.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef std::pair<int, int> Entry;
+
+/* ************************************************************************* *
+ * BULK LOAD - Ordenar y deduplicar en paralelo
+ * ************************************************************************* */
+
+static bool byKey(const Entry &a, const Entry &b) {
+    return a.first < b.first;
+}
+
+static bool sameKey(const Entry &a, const Entry &b) {
+    return a.first == b.first;
+}
+
+// Deja "entries" ordenado por clave y sin claves repetidas. Ante repetidos gana
+// el que aparece PRIMERO en la entrada, igual que con un loop de putIfAbsent. Por
+// eso todo es estable: stable_sort, inplace_merge y unique conservan el orden.
+static void parallelSortUnique(std::vector<Entry> &entries, unsigned threads) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    // Cada thread ordena y deduplica su pedazo. Los pedazos quedan con huecos al
+    // final (lo que unique descartó), así que recordamos dónde termina cada uno.
+    std::vector<size_t> begins(threads + 1);
+    for (unsigned t = 0; t <= threads; ++t) {
+        begins[t] = entries.size() * t / threads;
+    }
+    std::vector<size_t> ends(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&entries, &begins, &ends, t] {
+            auto first = entries.begin() + begins[t];
+            auto last = entries.begin() + begins[t + 1];
+            std::stable_sort(first, last, byKey);
+            ends[t] = std::unique(first, last, sameKey) - entries.begin();
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+
+    // Compactamos los pedazos uno detrás del otro, en orden.
+    size_t size = 0;
+    std::vector<size_t> runs;
+    for (unsigned t = 0; t < threads; ++t) {
+        runs.push_back(size);
+        size = std::move(entries.begin() + begins[t], entries.begin() + ends[t],
+                         entries.begin() + size) - entries.begin();
+    }
+    entries.resize(size);
+    runs.push_back(size);
+
+    // Mezclamos de a pares, en paralelo, hasta que quede una sola corrida. Mezclar
+    // siempre "izquierda con derecha" mantiene el orden de aparición.
+    while (runs.size() > 2) {
+        std::vector<size_t> merged;
+        workers.clear();
+        for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+            merged.push_back(runs[i]);
+            if (i + 2 < runs.size()) {
+                size_t first = runs[i], middle = runs[i + 1], last = runs[i + 2];
+                workers.push_back(std::thread([&entries, first, middle, last] {
+                    std::inplace_merge(entries.begin() + first, entries.begin() + middle,
+                                       entries.begin() + last, byKey);
+                }));
+            }
+        }
+        merged.push_back(runs.back());
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+        runs.swap(merged);
+    }
+
+    // Claves repetidas entre pedazos distintos quedaron juntas después del merge.
+    entries.erase(std::unique(entries.begin(), entries.end(), sameKey), entries.end());
+}
+
+// Con la entrada ordenada, cada inserción con hint "al final" es O(1) amortizado:
+// el árbol se arma en tiempo lineal.
+static void buildSorted(std::map<int, int> &map, const std::vector<Entry> &sorted) {
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        map.insert(map.end(), sorted[i]);
+    }
+}
+
+/* ************************************************************************* *
+ * MONITOR - El MapMonitor del paso 8, con un constructor de carga masiva
+ * ************************************************************************* */
+
+class MapMonitor {
+private:
+    std::map<int, int> internal;
+    std::mutex mutex;
+
+    bool contains(int key) {
+        return internal.find(key) != internal.end();
+    }
+
+public:
+    MapMonitor() = default;
+
+    // Durante el constructor el objeto todavía no es compartido: no hay lock.
+    MapMonitor(std::vector<Entry> entries, unsigned threads) {
+        parallelSortUnique(entries, threads);
+        buildSorted(internal, entries);
+    }
+
+    MapMonitor(const MapMonitor&) = delete;
+    MapMonitor& operator=(const MapMonitor&) = delete;
+
+    void putIfAbsent(int key, int value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!contains(key)) {
+            internal[key] = value;
+        }
+    }
+    void printIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (contains(key)) {
+            std::cout << "Par rescatado! (" << key << ", " << internal.at(key) << ")" << std::endl;
+        }
+    }
+    void removeIfPresent(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (contains(key)) {
+            internal.erase(key);
+        }
+    }
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return internal.size();
+    }
+};
+
+// Con varios shards cada uno se construye en su propio thread: primero cada
+// thread reparte SU pedazo de la entrada por shard, y después cada shard junta
+// sus partes (en orden) y se arma solo.
+class ShardedMapMonitor {
+private:
+    std::vector<MapMonitor*> shards;
+
+    size_t shardOf(int key) const {
+        return (unsigned(key) * 2654435761u) % shards.size();
+    }
+
+public:
+    ShardedMapMonitor(const std::vector<Entry> &entries, size_t shardCount) :
+        shards(shardCount == 0 ? 1 : shardCount, NULL) {
+        size_t count = shards.size();
+        // parts[slice][shard]
+        std::vector<std::vector<std::vector<Entry>>> parts(count,
+            std::vector<std::vector<Entry>>(count));
+        std::vector<std::thread> workers;
+        for (size_t slice = 0; slice < count; ++slice) {
+            workers.push_back(std::thread([&, slice] {
+                size_t begin = entries.size() * slice / count;
+                size_t end = entries.size() * (slice + 1) / count;
+                for (size_t i = begin; i < end; ++i) {
+                    parts[slice][shardOf(entries[i].first)].push_back(entries[i]);
+                }
+            }));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+
+        workers.clear();
+        for (size_t shard = 0; shard < count; ++shard) {
+            workers.push_back(std::thread([&, shard] {
+                std::vector<Entry> mine;
+                for (size_t slice = 0; slice < count; ++slice) {
+                    mine.insert(mine.end(), parts[slice][shard].begin(), parts[slice][shard].end());
+                }
+                shards[shard] = new MapMonitor(std::move(mine), 1);
+            }));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+
+    ShardedMapMonitor(const ShardedMapMonitor&) = delete;
+    ShardedMapMonitor& operator=(const ShardedMapMonitor&) = delete;
+
+    void putIfAbsent(int key, int value) {
+        shards[shardOf(key)]->putIfAbsent(key, value);
+    }
+    void printIfPresent(int key) {
+        shards[shardOf(key)]->printIfPresent(key);
+    }
+    void removeIfPresent(int key) {
+        shards[shardOf(key)]->removeIfPresent(key);
+    }
+    size_t size() {
+        size_t total = 0;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            total += shards[i]->size();
+        }
+        return total;
+    }
+
+    ~ShardedMapMonitor() {
+        for (size_t i = 0; i < shards.size(); ++i) {
+            delete shards[i];
+        }
+    }
+};
+
+static long millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void usingTheBulkLoad() {
+    // Un millón de pares desordenados, con muchas claves repetidas.
+    std::vector<Entry> entries;
+    std::srand(8);
+    for (int i = 0; i < 1000000; ++i) {
+        int key = std::rand() % 500000;
+        entries.push_back(std::make_pair(key, i));
+    }
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto start = std::chrono::steady_clock::now();
+    MapMonitor oneByOne;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        oneByOne.putIfAbsent(entries[i].first, entries[i].second);
+    }
+    std::cout << "De a uno: " << millisecondsSince(start) << "ms, "
+              << oneByOne.size() << " entradas" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    MapMonitor bulk(entries, threads);
+    std::cout << "Carga masiva: " << millisecondsSince(start) << "ms, "
+              << bulk.size() << " entradas" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    ShardedMapMonitor sharded(entries, threads);
+    std::cout << "Carga masiva en " << threads << " shards: " << millisecondsSince(start)
+              << "ms, " << sharded.size() << " entradas" << std::endl;
+
+    // Gana el primero que aparece, igual que con putIfAbsent.
+    for (int key = 0; key < 3; ++key) {
+        oneByOne.printIfPresent(key);
+        bulk.printIfPresent(key);
+        sharded.printIfPresent(key);
+    }
+}
+
+int main(int argc, char const *argv[]) {
+    usingTheBulkLoad();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Un objeto que todavía se está construyendo no es compartido: su constructor
+//    no necesita locks. Los threads del constructor se joinean antes de que termine.
+// 2. La semántica tiene que ser la misma que la del loop de putIfAbsent: gana el
+//    primero. Por eso se usan algoritmos estables.
+// 3. Insertar en un std::map con el hint correcto (end(), si viene ordenado) evita
+//    la búsqueda en el árbol.
+// 4. La carga masiva necesita memoria extra: la copia de la entrada que se ordena.
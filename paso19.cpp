@@ -0,0 +1,389 @@
+// Nos llegan alertas de "p99 alto" en el mapa, pero no sabemos QUÉ operación es la
+// lenta. ¿putIfAbsent? ¿printIfPresent, que escribe en consola con el mutex
+// tomado? Sin medir por operación, solo podemos adivinar.
+//
+// Agreguemos a ProtectedMap y a MapMonitor (los del paso 8) un histograma de
+// latencias por operación. Dos requisitos:
+// - Medir no puede agregar contención: si todos los threads incrementan el mismo
+//   contador, esa línea de cache rebota entre cores y medimos nuestro propio ruido.
+// - Un promedio no sirve para ver el p99: hace falta la distribución entera, con
+//   buckets logarítmicos (como HdrHistogram) para cubrir de nanosegundos a segundos.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ************************************************************************* *
+ * HISTOGRAMA - Buckets log-lineales y contadores por thread
+ * ************************************************************************* */
+
+// Cada potencia de 2 se parte en 8 sub-buckets: el error relativo de un percentil
+// es como mucho 1/8. Hasta 16ns los buckets son exactos.
+class LatencyHistogram {
+public:
+    static const int kSubBucketBits = 3;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kMaxExponent = 40;  // ~18 minutos en nanosegundos, sobra
+    static const int kBuckets = (kMaxExponent - kSubBucketBits) * kSubBuckets + 2 * kSubBuckets;
+
+    static int bucketOf(uint64_t nanos) {
+        if (nanos < 2 * kSubBuckets) {
+            return int(nanos);
+        }
+        int exponent = 63 - __builtin_clzll(nanos);
+        if (exponent > kMaxExponent) {
+            return kBuckets - 1;
+        }
+        int shift = exponent - kSubBucketBits;
+        return shift * kSubBuckets + int(nanos >> shift);
+    }
+
+    // El menor valor que cae en el bucket.
+    static uint64_t lowerBoundOf(int bucket) {
+        if (bucket < 2 * kSubBuckets) {
+            return bucket;
+        }
+        int shift = bucket / kSubBuckets - 1;
+        return uint64_t(bucket % kSubBuckets + kSubBuckets) << shift;
+    }
+
+private:
+    // Cada thread escribe en "su" shard. Los shards se separan con una línea de
+    // cache de relleno, así dos threads nunca escriben en la misma línea. (En
+    // C++11, new no respeta alignas mayores a alignof(max_align_t): por eso
+    // relleno y no alignas.)
+    static const int kShards = 16;
+    static const int kCacheLine = 64;
+
+    struct Shard {
+        std::atomic<uint64_t> counts[kBuckets];
+        char padding[kCacheLine];
+    };
+
+    Shard shards[kShards];
+
+    static int currentShard() {
+        static std::atomic<int> nextThread(0);
+        static thread_local int shard = nextThread.fetch_add(1) % kShards;
+        return shard;
+    }
+
+public:
+    LatencyHistogram() {
+        reset();
+    }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Lo que cuesta registrar: calcular el bucket y un incremento "relaxed" sobre
+    // una línea de cache que (casi siempre) es solo nuestra.
+    void record(uint64_t nanos) {
+        shards[currentShard()].counts[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Mezcla los shards en el momento. Los threads siguen registrando mientras
+    // tanto: el snapshot es aproximado, no una foto atómica.
+    std::vector<uint64_t> snapshot() const {
+        std::vector<uint64_t> merged(kBuckets, 0);
+        for (int s = 0; s < kShards; ++s) {
+            for (int b = 0; b < kBuckets; ++b) {
+                merged[b] += shards[s].counts[b].load(std::memory_order_relaxed);
+            }
+        }
+        return merged;
+    }
+
+    void reset() {
+        for (int s = 0; s < kShards; ++s) {
+            for (int b = 0; b < kBuckets; ++b) {
+                shards[s].counts[b].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Lo que se calcula a partir de un snapshot.
+struct LatencySummary {
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+
+    static uint64_t percentile(const std::vector<uint64_t> &counts, uint64_t total, double p) {
+        uint64_t rank = uint64_t(p * total);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < counts.size(); ++b) {
+            seen += counts[b];
+            if (seen > rank) {
+                return LatencyHistogram::lowerBoundOf(b);
+            }
+        }
+        return 0;
+    }
+
+    static LatencySummary of(const std::vector<uint64_t> &counts) {
+        LatencySummary summary = {0, 0, 0, 0, 0, 0};
+        for (size_t b = 0; b < counts.size(); ++b) {
+            summary.count += counts[b];
+            if (counts[b] != 0) {
+                summary.max = LatencyHistogram::lowerBoundOf(b);
+            }
+        }
+        if (summary.count != 0) {
+            summary.p50 = percentile(counts, summary.count, 0.50);
+            summary.p90 = percentile(counts, summary.count, 0.90);
+            summary.p99 = percentile(counts, summary.count, 0.99);
+            summary.p999 = percentile(counts, summary.count, 0.999);
+        }
+        return summary;
+    }
+};
+
+/* ************************************************************************* *
+ * TELEMETRÍA - Un histograma por operación
+ * ************************************************************************* */
+
+class MapTelemetry {
+private:
+    std::vector<std::string> names;
+    std::vector<LatencyHistogram*> histograms;
+
+public:
+    explicit MapTelemetry(const std::vector<std::string> &operations) : names(operations) {
+        for (size_t i = 0; i < names.size(); ++i) {
+            histograms.push_back(new LatencyHistogram());
+        }
+    }
+
+    MapTelemetry(const MapTelemetry&) = delete;
+    MapTelemetry& operator=(const MapTelemetry&) = delete;
+
+    LatencyHistogram &operator[](size_t operation) {
+        return *histograms[operation];
+    }
+
+    std::vector<LatencySummary> snapshot() const {
+        std::vector<LatencySummary> summaries;
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            summaries.push_back(LatencySummary::of(histograms[i]->snapshot()));
+        }
+        return summaries;
+    }
+
+    void reset() {
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            histograms[i]->reset();
+        }
+    }
+
+    // Los percentiles son la cota inferior de su bucket, en nanosegundos.
+    std::string toText() const {
+        std::vector<LatencySummary> summaries = snapshot();
+        std::ostringstream out;
+        for (size_t i = 0; i < summaries.size(); ++i) {
+            const LatencySummary &s = summaries[i];
+            out << names[i] << ": n=" << s.count << " p50=" << s.p50 << "ns p90=" << s.p90
+                << "ns p99=" << s.p99 << "ns p99.9=" << s.p999 << "ns max=" << s.max << "ns\n";
+        }
+        return out.str();
+    }
+
+    std::string toJson() const {
+        std::vector<LatencySummary> summaries = snapshot();
+        std::ostringstream out;
+        out << "{";
+        for (size_t i = 0; i < summaries.size(); ++i) {
+            const LatencySummary &s = summaries[i];
+            out << (i == 0 ? "" : ",") << "\"" << names[i] << "\":{\"count\":" << s.count
+                << ",\"p50\":" << s.p50 << ",\"p90\":" << s.p90 << ",\"p99\":" << s.p99
+                << ",\"p999\":" << s.p999 << ",\"max\":" << s.max << "}";
+        }
+        out << "}";
+        return out.str();
+    }
+
+    ~MapTelemetry() {
+        for (size_t i = 0; i < histograms.size(); ++i) {
+            delete histograms[i];
+        }
+    }
+};
+
+// RAII, una vez más: mide desde que se construye hasta que se destruye. Se declara
+// ANTES del lock_guard, así la medición incluye la espera por el mutex (que es lo
+// que ve quien llama).
+class ScopedLatency {
+private:
+    LatencyHistogram &histogram;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedLatency(LatencyHistogram &histogram) :
+        histogram(histogram), start(std::chrono::steady_clock::now()) {
+    }
+
+    ~ScopedLatency() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+/* ************************************************************************* *
+ * MONITORES - Los del paso 8, instrumentados
+ * ************************************************************************* */
+
+class ProtectedMap {
+private:
+    std::map<int, int> internal;
+    std::mutex mutex;
+
+public:
+    enum Operation { PUT, GET, CONTAINS, REMOVE };
+
+    MapTelemetry telemetry;
+
+    ProtectedMap() : telemetry({"put", "get", "contains", "remove"}) {}
+
+    void put(int key, int value) {
+        ScopedLatency latency(telemetry[PUT]);
+        std::lock_guard<std::mutex> lock(mutex);
+        internal[key] = value;
+    }
+    int get(int key) {
+        ScopedLatency latency(telemetry[GET]);
+        std::lock_guard<std::mutex> lock(mutex);
+        return internal.at(key);
+    }
+    bool contains(int key) {
+        ScopedLatency latency(telemetry[CONTAINS]);
+        std::lock_guard<std::mutex> lock(mutex);
+        return internal.find(key) != internal.end();
+    }
+    void remove(int key) {
+        ScopedLatency latency(telemetry[REMOVE]);
+        std::lock_guard<std::mutex> lock(mutex);
+        internal.erase(key);
+    }
+};
+
+class MapMonitor {
+private:
+    std::map<int, int> internal;
+    std::mutex mutex;
+
+    bool contains(int key) {
+        return internal.find(key) != internal.end();
+    }
+
+public:
+    enum Operation { PUT_IF_ABSENT, PRINT_IF_PRESENT, REMOVE_IF_PRESENT };
+
+    MapTelemetry telemetry;
+
+    MapMonitor() : telemetry({"putIfAbsent", "printIfPresent", "removeIfPresent"}) {}
+
+    void putIfAbsent(int key, int value) {
+        ScopedLatency latency(telemetry[PUT_IF_ABSENT]);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!contains(key)) {
+            internal[key] = value;
+        }
+    }
+    void printIfPresent(int key) {
+        ScopedLatency latency(telemetry[PRINT_IF_PRESENT]);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (contains(key)) {
+            std::cout << "Par rescatado! (" << key << ", " << internal.at(key) << ")" << std::endl;
+        }
+    }
+    void removeIfPresent(int key) {
+        ScopedLatency latency(telemetry[REMOVE_IF_PRESENT]);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (contains(key)) {
+            internal.erase(key);
+        }
+    }
+};
+
+void measuringTheWeakMonitor() {
+    ProtectedMap map;
+    for (int key = 0; key < 100; ++key) {
+        map.put(key, key);
+    }
+
+    std::thread remover_thread([&] {
+        for (int key = 0; key < 100; ++key) {
+            if (map.contains(key)) {
+                map.remove(key);
+            }
+        }
+    });
+
+    std::thread printer_thread([&] {
+        for (int key = 99; key >= 0; --key) {
+            if (map.contains(key)) {
+                try {
+                    std::cout << "Par rescatado! (" << key << ", " << map.get(key) << ")" << std::endl;
+                } catch (const std::out_of_range &e) {
+                    // La race condition del paso 8, ahora visible.
+                    std::cout << "Se lo llevaron entre el contains y el get! (" << key << ")" << std::endl;
+                }
+            }
+        }
+    });
+
+    printer_thread.join();
+    remover_thread.join();
+    std::cout << map.telemetry.toText();
+}
+
+void measuringTheGoodMonitor() {
+    MapMonitor map;
+    for (int key = 0; key < 100; ++key) {
+        map.putIfAbsent(key, key);
+    }
+
+    std::thread remover_thread([&] {
+        for (int key = 0; key < 100; ++key) {
+            map.removeIfPresent(key);
+        }
+    });
+
+    std::thread printer_thread([&] {
+        for (int key = 99; key >= 0; --key) {
+            map.printIfPresent(key);
+        }
+    });
+
+    printer_thread.join();
+    remover_thread.join();
+    std::cout << map.telemetry.toJson() << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+    measuringTheWeakMonitor();
+    measuringTheGoodMonitor();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Medir también es acceder a memoria compartida. Con un contador por thread
+//    (separado por líneas de cache) el costo de medir no depende de cuántos
+//    threads haya.
+// 2. Leer el reloj (steady_clock::now) cuesta más que registrar en el histograma.
+// 3. El snapshot mezcla los shards "en caliente": los números son consistentes
+//    de a bucket, no entre buckets. Para monitoreo alcanza.
+// 4. printIfPresent escribe en consola con el mutex tomado: el histograma es el
+//    que nos muestra cuánto cuesta eso.
@@ -0,0 +1,369 @@
+// El std::map del paso 8 tiene algo que un hash no tiene: las claves están
+// ordenadas. Si dependemos de consultas por rango ("todas las claves en [a, b)"),
+// no podemos cambiarlo por un unordered_map, y entonces seguimos atados a UN mutex
+// para todo el árbol.
+//
+// Una estructura ordenada que se lleva mucho mejor con la concurrencia es la skip
+// list: una lista enlazada ordenada con "atajos" en niveles superiores. Acá va la
+// "lazy skip list" (Herlihy, Lev, Luchangco y Shavit):
+// - Las búsquedas no toman NINGÚN lock.
+// - Insertar y borrar bloquean solamente los nodos vecinos, y validan
+//   (optimistic locking) que nadie los cambió mientras tanto.
+// - Recorrer un rango tampoco toma locks: nunca frena a los escritores.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* ************************************************************************* *
+ * SKIP LIST - Nodos con un lock propio
+ * ************************************************************************* */
+
+// El mismo SpinLock del paso 17: cada nodo tiene el suyo y las critical sections
+// son de un puñado de instrucciones, un std::mutex por nodo sería demasiado.
+class SpinLock {
+private:
+    std::atomic<bool> locked;
+
+public:
+    SpinLock() : locked(false) {}
+
+    void lock() {
+        for (;;) {
+            if (!locked.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            while (locked.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+class ConcurrentSkipListMap {
+private:
+    static const int kMaxLevel = 16;
+
+    struct Node {
+        int key;
+        int value;
+        int topLevel;
+        std::atomic<Node*> next[kMaxLevel];
+        // "marked": borrado lógicamente. "fullyLinked": ya está enlazado en todos
+        // sus niveles. Solo los nodos fullyLinked y no marked "están" en el mapa.
+        std::atomic<bool> marked;
+        std::atomic<bool> fullyLinked;
+        SpinLock lock;
+
+        Node(int key, int value, int topLevel) :
+            key(key), value(value), topLevel(topLevel), marked(false), fullyLinked(false) {
+            for (int level = 0; level < kMaxLevel; ++level) {
+                next[level].store(NULL, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // Centinelas: head es "menor" que todo y tail "mayor" que todo. Comparamos por
+    // puntero, así cualquier int es una clave válida.
+    Node head;
+    Node tail;
+
+    // Un nodo borrado puede estar siendo leído por alguien que lo encontró antes
+    // del borrado, así que no se puede liberar en el momento. Acá simplemente los
+    // juntamos y los liberamos en el destructor.
+    std::mutex retiredMutex;
+    std::vector<Node*> retired;
+
+    bool before(const Node *node, int key) const {
+        return node != &tail && node->key < key;
+    }
+
+    static int randomLevel() {
+        static thread_local uint32_t state =
+            2463534242u ^ uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        // xorshift32: cada nivel extra con probabilidad 1/2.
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        int level = 1;
+        uint32_t bits = state;
+        while (level < kMaxLevel && (bits & 1)) {
+            ++level;
+            bits >>= 1;
+        }
+        return level;
+    }
+
+    // Busca sin locks. Llena preds/succs en cada nivel y devuelve el nivel más alto
+    // en el que encontró la clave, o -1.
+    int find(int key, Node *preds[], Node *succs[]) {
+        int found = -1;
+        Node *pred = &head;
+        for (int level = kMaxLevel - 1; level >= 0; --level) {
+            Node *curr = pred->next[level].load(std::memory_order_acquire);
+            while (before(curr, key)) {
+                pred = curr;
+                curr = pred->next[level].load(std::memory_order_acquire);
+            }
+            if (found == -1 && curr != &tail && curr->key == key) {
+                found = level;
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+        return found;
+    }
+
+    // Los predecesores se bloquean de abajo hacia arriba (siempre en el mismo orden:
+    // nada de deadlocks como en el paso 10), salteando los repetidos.
+    static int lockPredecessors(Node *preds[], int levels) {
+        Node *previous = NULL;
+        int highestLocked = -1;
+        for (int level = 0; level < levels; ++level) {
+            if (preds[level] != previous) {
+                preds[level]->lock.lock();
+                previous = preds[level];
+            }
+            highestLocked = level;
+        }
+        return highestLocked;
+    }
+
+    static void unlockPredecessors(Node *preds[], int highestLocked) {
+        Node *previous = NULL;
+        for (int level = 0; level <= highestLocked; ++level) {
+            if (preds[level] != previous) {
+                preds[level]->lock.unlock();
+                previous = preds[level];
+            }
+        }
+    }
+
+    bool isLive(const Node *node) const {
+        return node->fullyLinked.load(std::memory_order_acquire) &&
+               !node->marked.load(std::memory_order_acquire);
+    }
+
+public:
+    ConcurrentSkipListMap() : head(0, 0, kMaxLevel), tail(0, 0, kMaxLevel) {
+        for (int level = 0; level < kMaxLevel; ++level) {
+            head.next[level].store(&tail, std::memory_order_relaxed);
+        }
+        head.fullyLinked.store(true);
+        tail.fullyLinked.store(true);
+    }
+
+    ConcurrentSkipListMap(const ConcurrentSkipListMap&) = delete;
+    ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&) = delete;
+
+    bool putIfAbsent(int key, int value) {
+        int topLevel = randomLevel();
+        Node *preds[kMaxLevel];
+        Node *succs[kMaxLevel];
+        for (;;) {
+            int found = find(key, preds, succs);
+            if (found != -1) {
+                Node *existing = succs[found];
+                if (!existing->marked.load(std::memory_order_acquire)) {
+                    // Alguien la está insertando: esperamos a que termine, así
+                    // después de volver la clave seguro "está".
+                    while (!existing->fullyLinked.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    return false;
+                }
+                // Se está borrando: reintentamos hasta que desaparezca.
+                continue;
+            }
+
+            int highestLocked = lockPredecessors(preds, topLevel);
+            // Validación optimista: lo que vimos sin locks sigue siendo cierto?
+            bool valid = true;
+            for (int level = 0; valid && level < topLevel; ++level) {
+                valid = !preds[level]->marked.load(std::memory_order_acquire) &&
+                        !succs[level]->marked.load(std::memory_order_acquire) &&
+                        preds[level]->next[level].load(std::memory_order_acquire) == succs[level];
+            }
+            if (!valid) {
+                unlockPredecessors(preds, highestLocked);
+                continue;
+            }
+
+            Node *node = new Node(key, value, topLevel);
+            for (int level = 0; level < topLevel; ++level) {
+                node->next[level].store(succs[level], std::memory_order_relaxed);
+            }
+            for (int level = 0; level < topLevel; ++level) {
+                preds[level]->next[level].store(node, std::memory_order_release);
+            }
+            node->fullyLinked.store(true, std::memory_order_release);
+            unlockPredecessors(preds, highestLocked);
+            return true;
+        }
+    }
+
+    bool removeIfPresent(int key) {
+        Node *preds[kMaxLevel];
+        Node *succs[kMaxLevel];
+        Node *victim = NULL;
+        bool isMarked = false;
+        int topLevel = -1;
+        for (;;) {
+            int found = find(key, preds, succs);
+            if (!isMarked) {
+                if (found == -1) {
+                    return false;
+                }
+                victim = succs[found];
+                // Solo se borra un nodo completamente enlazado, y que encontramos
+                // en su nivel más alto.
+                if (!isLive(victim) || victim->topLevel - 1 != found) {
+                    return false;
+                }
+                topLevel = victim->topLevel;
+                victim->lock.lock();
+                if (victim->marked.load(std::memory_order_acquire)) {
+                    // Otro thread nos ganó el borrado.
+                    victim->lock.unlock();
+                    return false;
+                }
+                // Borrado lógico: desde acá, para todos, la clave ya no está.
+                victim->marked.store(true, std::memory_order_release);
+                isMarked = true;
+            }
+
+            int highestLocked = lockPredecessors(preds, topLevel);
+            bool valid = true;
+            for (int level = 0; valid && level < topLevel; ++level) {
+                valid = !preds[level]->marked.load(std::memory_order_acquire) &&
+                        preds[level]->next[level].load(std::memory_order_acquire) == victim;
+            }
+            if (!valid) {
+                unlockPredecessors(preds, highestLocked);
+                continue;
+            }
+
+            // Borrado físico: lo desenganchamos de arriba hacia abajo.
+            for (int level = topLevel - 1; level >= 0; --level) {
+                preds[level]->next[level].store(victim->next[level].load(std::memory_order_acquire),
+                                                std::memory_order_release);
+            }
+            victim->lock.unlock();
+            unlockPredecessors(preds, highestLocked);
+
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            retired.push_back(victim);
+            return true;
+        }
+    }
+
+    bool get(int key, int &value) {
+        Node *preds[kMaxLevel];
+        Node *succs[kMaxLevel];
+        int found = find(key, preds, succs);
+        if (found == -1 || !isLive(succs[found])) {
+            return false;
+        }
+        value = succs[found]->value;
+        return true;
+    }
+
+    void printIfPresent(int key) {
+        int value;
+        if (get(key, value)) {
+            std::cout << "Par rescatado! (" << key << ", " << value << ")" << std::endl;
+        }
+    }
+
+    // Recorre las claves en [from, to) sin tomar locks. Es "débilmente consistente":
+    // ve todo lo que estaba antes de empezar y no se borró, y puede ver (o no) lo
+    // que se inserte o borre mientras recorre. Nunca ve una clave dos veces ni
+    // fuera de orden.
+    template <class Visitor>
+    void forEachInRange(int from, int to, Visitor visit) {
+        Node *preds[kMaxLevel];
+        Node *succs[kMaxLevel];
+        find(from, preds, succs);
+        for (Node *node = succs[0]; before(node, to);
+             node = node->next[0].load(std::memory_order_acquire)) {
+            if (isLive(node)) {
+                visit(node->key, node->value);
+            }
+        }
+    }
+
+    ~ConcurrentSkipListMap() {
+        Node *node = head.next[0].load();
+        while (node != &tail) {
+            Node *next = node->next[0].load();
+            delete node;
+            node = next;
+        }
+        for (size_t i = 0; i < retired.size(); ++i) {
+            delete retired[i];
+        }
+    }
+};
+
+void usingTheSkipList() {
+    ConcurrentSkipListMap map;
+
+    // Cuatro threads insertando a la vez, en claves intercaladas.
+    std::vector<std::thread> inserters;
+    for (int t = 0; t < 4; ++t) {
+        inserters.push_back(std::thread([&map, t] {
+            for (int key = t; key < 1000; key += 4) {
+                map.putIfAbsent(key, key);
+            }
+        }));
+    }
+    for (size_t i = 0; i < inserters.size(); ++i) {
+        inserters[i].join();
+    }
+
+    // Un thread borra las claves pares mientras otro recorre un rango. El que
+    // recorre nunca bloquea al que borra.
+    std::thread remover_thread([&] {
+        for (int key = 0; key < 1000; key += 2) {
+            map.removeIfPresent(key);
+        }
+    });
+
+    std::thread scanner_thread([&] {
+        int seen = 0;
+        map.forEachInRange(100, 200, [&](int, int) { ++seen; });
+        std::cout << "El scanner vio " << seen << " claves en [100, 200)" << std::endl;
+    });
+
+    scanner_thread.join();
+    remover_thread.join();
+
+    // Ya sin nadie escribiendo, el rango es exacto: solo quedan las impares.
+    map.forEachInRange(100, 110, [](int key, int value) {
+        std::cout << "Par rescatado! (" << key << ", " << value << ")" << std::endl;
+    });
+}
+
+int main(int argc, char const *argv[]) {
+    usingTheSkipList();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Las búsquedas y los recorridos no toman locks: solo leen punteros atómicos.
+//    Los escritores bloquean unos pocos nodos vecinos, no toda la estructura.
+// 2. Optimistic locking: buscar sin locks, bloquear, y VALIDAR que lo que vimos
+//    sigue valiendo. Si no, soltar todo y reintentar.
+// 3. Los locks se toman siempre en el mismo orden (de abajo hacia arriba), así no
+//    hay deadlocks.
+// 4. Los nodos borrados no se liberan hasta el destructor, porque un lector puede
+//    estar parado sobre ellos. En producción eso se resuelve con epoch-based
+//    reclamation o hazard pointers; acá la memoria de los borrados se acumula.
@@ -0,0 +1,308 @@
+// El paso 9 envuelve solamente mutexes. Pero muchos problemas son "por fases":
+// "que todos los printers arranquen juntos", "esperar a que todos los workers
+// terminen la ronda". Armarlos con mutex + condition variable + contador anda,
+// pero cada despertar pasa por el mutex: los threads se despiertan de a uno y
+// vuelven a competir por el lock.
+//
+// En Linux, todas esas primitivas están construidas sobre un único syscall: el
+// futex ("fast userspace mutex"). La idea es simple: mientras no haya que dormir,
+// todo se resuelve con atómicos en espacio de usuario; solo si hay que dormir se
+// llama al kernel, diciéndole "dormime si esta dirección todavía vale X".
+//
+// Armemos Semaphore, Latch y Barrier directamente sobre futex, con una fase corta
+// de spin antes de dormir.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* ************************************************************************* *
+ * FUTEX - El único syscall que hace falta
+ * ************************************************************************* */
+
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "El futex opera sobre un int de 32 bits");
+
+// Duerme si *address sigue valiendo expected. Si ya cambió, vuelve enseguida: esa
+// comparación la hace el kernel de forma atómica, y es lo que evita perder un wake.
+static void futexWait(std::atomic<int> &address, int expected) {
+    syscall(SYS_futex, (int*) &address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futexWake(std::atomic<int> &address, int count) {
+    syscall(SYS_futex, (int*) &address, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+// Le avisa al core que estamos girando (en x86, la instrucción "pause").
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Con un solo core, girar es tiempo robado al thread que esperamos: no giramos.
+static const int kSpinIterations = std::thread::hardware_concurrency() > 1 ? 200 : 0;
+
+/* ************************************************************************* *
+ * PRIMITIVAS - Semaphore, Latch y Barrier
+ * ************************************************************************* */
+
+class Semaphore {
+private:
+    std::atomic<int> count;
+    std::atomic<int> waiters;
+
+    bool tryAcquire() {
+        int current = count.load();
+        while (current > 0) {
+            if (count.compare_exchange_weak(current, current - 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit Semaphore(int initial) : count(initial), waiters(0) {}
+
+    Semaphore(const Semaphore&) = delete;
+    Semaphore& operator=(const Semaphore&) = delete;
+
+    void acquire() {
+        for (int i = 0; i < kSpinIterations; ++i) {
+            if (tryAcquire()) {
+                return;
+            }
+            cpuRelax();
+        }
+        // Nos anotamos como "durmiente" ANTES de volver a mirar el contador: así
+        // el release que llegue después seguro nos ve y nos despierta.
+        waiters.fetch_add(1);
+        while (!tryAcquire()) {
+            futexWait(count, 0);
+        }
+        waiters.fetch_sub(1);
+    }
+
+    void release(int n = 1) {
+        count.fetch_add(n);
+        // Si nadie duerme, release no entra nunca al kernel.
+        if (waiters.load() > 0) {
+            futexWake(count, n);
+        }
+    }
+};
+
+// Un Latch se usa UNA vez: arranca en N, cada countDown resta uno, y wait
+// bloquea hasta que llegue a cero.
+class Latch {
+private:
+    std::atomic<int> remaining;
+
+public:
+    explicit Latch(int count) : remaining(count) {}
+
+    Latch(const Latch&) = delete;
+    Latch& operator=(const Latch&) = delete;
+
+    void countDown() {
+        if (remaining.fetch_sub(1) == 1) {
+            futexWake(remaining, INT_MAX);
+        }
+    }
+
+    void wait() {
+        for (int i = 0; i < kSpinIterations; ++i) {
+            if (remaining.load() == 0) {
+                return;
+            }
+            cpuRelax();
+        }
+        for (;;) {
+            int current = remaining.load();
+            if (current == 0) {
+                return;
+            }
+            futexWait(remaining, current);
+        }
+    }
+};
+
+// Una Barrier se reutiliza: ronda tras ronda, nadie pasa hasta que llegaron los N.
+// Los que esperan miran "generation", y los que llegan escriben "arrived". Están
+// en líneas de cache distintas para que cada llegada no invalide la línea sobre la
+// que están girando los demás.
+class Barrier {
+private:
+    static const int kCacheLine = 64;
+
+    const int parties;
+    char padding0[kCacheLine];
+    std::atomic<int> arrived;
+    char padding1[kCacheLine];
+    std::atomic<int> generation;
+    char padding2[kCacheLine];
+
+public:
+    explicit Barrier(int parties) : parties(parties), arrived(0), generation(0) {}
+
+    Barrier(const Barrier&) = delete;
+    Barrier& operator=(const Barrier&) = delete;
+
+    void arriveAndWait() {
+        int myGeneration = generation.load();
+        if (arrived.fetch_add(1) + 1 == parties) {
+            // El último en llegar abre la barrera para esta ronda. Primero deja
+            // "arrived" listo para la próxima, después avanza la generación.
+            arrived.store(0);
+            generation.fetch_add(1);
+            futexWake(generation, INT_MAX);
+            return;
+        }
+        for (int i = 0; i < kSpinIterations; ++i) {
+            if (generation.load() != myGeneration) {
+                return;
+            }
+            cpuRelax();
+        }
+        while (generation.load() == myGeneration) {
+            futexWait(generation, myGeneration);
+        }
+    }
+};
+
+// La versión "de siempre", para comparar: mutex + condition variable + contador.
+class CondVarBarrier {
+private:
+    const int parties;
+    int arrived;
+    int generation;
+    std::mutex mutex;
+    std::condition_variable released;
+
+public:
+    explicit CondVarBarrier(int parties) : parties(parties), arrived(0), generation(0) {}
+
+    void arriveAndWait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        int myGeneration = generation;
+        if (++arrived == parties) {
+            arrived = 0;
+            ++generation;
+            released.notify_all();
+            return;
+        }
+        released.wait(lock, [&] { return generation != myGeneration; });
+    }
+};
+
+/* ************************************************************************* *
+ * USO - Printers que arrancan juntos
+ * ************************************************************************* */
+
+void usingLatchAndSemaphore() {
+    Latch start(1);
+    Latch done(3);
+    // Un semáforo con 1 permiso es un mutex: protege a std::cout como en el paso 7.
+    Semaphore console(1);
+
+    const char *colors[] = {"\x1B[31m", "\x1B[32m", "\x1B[33m"};
+    const char *names[] = {"RED", "GREEN", "YELLOW"};
+
+    std::vector<std::thread> printers;
+    for (int p = 0; p < 3; ++p) {
+        printers.push_back(std::thread([&, p] {
+            // Nadie imprime hasta que main dé la largada.
+            start.wait();
+            for (int i = 0; i < 5; ++i) {
+                console.acquire();
+                std::cout << colors[p] << names[p] << "\033[0m" << std::endl;
+                console.release();
+            }
+            done.countDown();
+        }));
+    }
+
+    start.countDown();
+    done.wait();
+    std::cout << "Terminaron los tres printers" << std::endl;
+
+    // Que done.wait() haya vuelto no nos libera de joinear.
+    for (size_t i = 0; i < printers.size(); ++i) {
+        printers[i].join();
+    }
+}
+
+/* ************************************************************************* *
+ * BENCHMARK - Latencia de una ronda de barrera, de 2 a N threads
+ * ************************************************************************* */
+
+// Crear y joinear los threads queda afuera de la medición: el worker 0 mide desde
+// que todos pasaron una ronda de calentamiento hasta que termina la última.
+template <class AnyBarrier>
+double roundTripNanos(int threads, int rounds) {
+    AnyBarrier barrier(threads);
+    std::chrono::steady_clock::time_point start, end;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t] {
+            barrier.arriveAndWait();
+            if (t == 0) {
+                start = std::chrono::steady_clock::now();
+            }
+            for (int r = 0; r < rounds; ++r) {
+                barrier.arriveAndWait();
+            }
+            if (t == 0) {
+                end = std::chrono::steady_clock::now();
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / rounds;
+}
+
+void benchmarkBarriers() {
+    const int rounds = 20000;
+    int maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    // Potencias de 2, y siempre también maxThreads aunque no lo sea (6, 12...).
+    std::vector<int> counts;
+    for (int threads = 2; threads < maxThreads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(maxThreads);
+
+    std::cout << "threads\tfutex (ns/ronda)\tcondvar (ns/ronda)" << std::endl;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        std::cout << counts[i] << "\t" << roundTripNanos<Barrier>(counts[i], rounds)
+                  << "\t\t" << roundTripNanos<CondVarBarrier>(counts[i], rounds) << std::endl;
+    }
+}
+
+int main(int argc, char const *argv[]) {
+    usingLatchAndSemaphore();
+    benchmarkBarriers();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. En el caso sin contención, ninguna de estas primitivas entra al kernel: todo
+//    es un par de instrucciones atómicas. El futex solo se usa para dormir.
+// 2. La fase de spin sirve cuando la espera es corta y hay cores libres. Si hay más
+//    threads que cores, girar le roba el core justo al thread que esperamos: por
+//    eso el spin es corto y después se duerme.
+// 3. FUTEX_WAIT compara y duerme de forma atómica: si el valor ya cambió, no
+//    duerme. Sin eso, un wake entre "miro" y "duermo" se perdería para siempre.
+// 4. futex es específico de Linux. En otros sistemas, C++20 trae std::latch,
+//    std::barrier y std::counting_semaphore, que por adentro hacen lo mismo.
@@ -0,0 +1,338 @@
+// El MapMonitor del paso 8 hace atómica cada operación sobre UNA clave. Pero si
+// queremos "mover el valor de la clave A a la clave B", o "cambiar estas tres
+// entradas solo si todas valen lo que esperamos", volvemos al problema de
+// complementWithLocks: un mutex externo y grueso que serializa TODO, aunque dos
+// transacciones toquen claves que no tienen nada que ver.
+//
+// La solución: partir el mapa en shards, cada uno con su mutex, y que una
+// transacción bloquee SOLO los shards de las claves que toca. Para no caer en el
+// deadlock del paso 10, los mutex se toman siempre en el mismo orden (de menor a
+// mayor índice de shard). Dos transacciones sobre shards distintos corren
+// totalmente en paralelo.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* ************************************************************************* *
+ * TRANSACCIÓN - Una lista de operaciones que se aplican todas o ninguna
+ * ************************************************************************* */
+
+class Transaction {
+public:
+    enum Kind {
+        INSERT,            // la clave tiene que NO estar
+        REMOVE,            // la clave tiene que estar
+        COMPARE_AND_SWAP,  // la clave tiene que estar y valer "expected"
+        MOVE               // "key" tiene que estar y "target" no: se mueve el valor
+    };
+
+    struct Operation {
+        Kind kind;
+        int key;
+        int target;
+        int expected;
+        int value;
+    };
+
+    Transaction &insert(int key, int value) {
+        Operation op = {INSERT, key, 0, 0, value};
+        operations.push_back(op);
+        return *this;
+    }
+
+    Transaction &remove(int key) {
+        Operation op = {REMOVE, key, 0, 0, 0};
+        operations.push_back(op);
+        return *this;
+    }
+
+    Transaction &compareAndSwap(int key, int expected, int desired) {
+        Operation op = {COMPARE_AND_SWAP, key, 0, expected, desired};
+        operations.push_back(op);
+        return *this;
+    }
+
+    Transaction &move(int from, int to) {
+        Operation op = {MOVE, from, to, 0, 0};
+        operations.push_back(op);
+        return *this;
+    }
+
+private:
+    friend class TransactionalMapMonitor;
+    std::vector<Operation> operations;
+};
+
+/* ************************************************************************* *
+ * MONITOR - Shards con su propio mutex, bloqueados en orden
+ * ************************************************************************* */
+
+class TransactionalMapMonitor {
+private:
+    static const size_t kShards = 64;
+
+    // Cada shard en su propia línea de cache (o más): que dos threads usando
+    // shards vecinos no se peleen por la misma línea.
+    struct Shard {
+        std::mutex mutex;
+        std::map<int, int> internal;
+        char padding[64];
+    };
+
+    Shard shards[kShards];
+
+    static size_t shardOf(int key) {
+        return (unsigned(key) * 2654435761u) % kShards;
+    }
+
+    // Lo que hay que deshacer si una operación posterior falla.
+    struct Undo {
+        int key;
+        bool wasPresent;
+        int oldValue;
+    };
+
+    void record(std::vector<Undo> &undo, int key) {
+        std::map<int, int> &map = shards[shardOf(key)].internal;
+        auto it = map.find(key);
+        Undo entry = {key, it != map.end(), it != map.end() ? it->second : 0};
+        undo.push_back(entry);
+    }
+
+    bool apply(const Transaction::Operation &op, std::vector<Undo> &undo) {
+        std::map<int, int> &map = shards[shardOf(op.key)].internal;
+        auto it = map.find(op.key);
+        switch (op.kind) {
+        case Transaction::INSERT:
+            if (it != map.end()) {
+                return false;
+            }
+            record(undo, op.key);
+            map[op.key] = op.value;
+            return true;
+        case Transaction::REMOVE:
+            if (it == map.end()) {
+                return false;
+            }
+            record(undo, op.key);
+            map.erase(it);
+            return true;
+        case Transaction::COMPARE_AND_SWAP:
+            if (it == map.end() || it->second != op.expected) {
+                return false;
+            }
+            record(undo, op.key);
+            it->second = op.value;
+            return true;
+        case Transaction::MOVE: {
+            std::map<int, int> &targetMap = shards[shardOf(op.target)].internal;
+            if (it == map.end() || targetMap.find(op.target) != targetMap.end()) {
+                return false;
+            }
+            int value = it->second;
+            record(undo, op.key);
+            record(undo, op.target);
+            map.erase(it);
+            targetMap[op.target] = value;
+            return true;
+        }
+        }
+        return false;
+    }
+
+    void rollback(const std::vector<Undo> &undo) {
+        for (size_t i = undo.size(); i > 0; --i) {
+            const Undo &entry = undo[i - 1];
+            std::map<int, int> &map = shards[shardOf(entry.key)].internal;
+            if (entry.wasPresent) {
+                map[entry.key] = entry.oldValue;
+            } else {
+                map.erase(entry.key);
+            }
+        }
+    }
+
+    // Los índices de shard que toca la transacción, ordenados y sin repetir.
+    static std::vector<size_t> shardsOf(const Transaction &tx) {
+        std::vector<size_t> indexes;
+        for (size_t i = 0; i < tx.operations.size(); ++i) {
+            indexes.push_back(shardOf(tx.operations[i].key));
+            if (tx.operations[i].kind == Transaction::MOVE) {
+                indexes.push_back(shardOf(tx.operations[i].target));
+            }
+        }
+        std::sort(indexes.begin(), indexes.end());
+        indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+        return indexes;
+    }
+
+    // RAII sobre un conjunto de shards: bloquea en orden ascendente y libera en el
+    // orden inverso.
+    class ShardLocks {
+    private:
+        TransactionalMapMonitor &monitor;
+        std::vector<size_t> indexes;
+
+    public:
+        ShardLocks(TransactionalMapMonitor &monitor, const std::vector<size_t> &indexes) :
+            monitor(monitor), indexes(indexes) {
+            for (size_t i = 0; i < indexes.size(); ++i) {
+                monitor.shards[indexes[i]].mutex.lock();
+            }
+        }
+
+        ~ShardLocks() {
+            for (size_t i = indexes.size(); i > 0; --i) {
+                monitor.shards[indexes[i - 1]].mutex.unlock();
+            }
+        }
+    };
+
+public:
+    // Las operaciones de una sola clave siguen siendo las del paso 8: un shard.
+
+    void putIfAbsent(int key, int value) {
+        Shard &shard = shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.internal.find(key) == shard.internal.end()) {
+            shard.internal[key] = value;
+        }
+    }
+
+    bool getIfPresent(int key, int &value) {
+        Shard &shard = shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.internal.find(key);
+        if (it == shard.internal.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    void printIfPresent(int key) {
+        Shard &shard = shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.internal.find(key);
+        if (it != shard.internal.end()) {
+            std::cout << "Par rescatado! (" << key << ", " << it->second << ")" << std::endl;
+        }
+    }
+
+    void removeIfPresent(int key) {
+        Shard &shard = shards[shardOf(key)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.internal.erase(key);
+    }
+
+    // Aplica todas las operaciones, en orden, o ninguna. Mientras tanto los shards
+    // involucrados están bloqueados, así que nadie ve un estado intermedio.
+    bool commit(const Transaction &tx) {
+        ShardLocks locks(*this, shardsOf(tx));
+        std::vector<Undo> undo;
+        for (size_t i = 0; i < tx.operations.size(); ++i) {
+            if (!apply(tx.operations[i], undo)) {
+                rollback(undo);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Una lectura consistente de TODO el mapa también es "una transacción": toma
+    // todos los shards, en el mismo orden que siempre.
+    long sum() {
+        std::vector<size_t> all;
+        for (size_t i = 0; i < kShards; ++i) {
+            all.push_back(i);
+        }
+        ShardLocks locks(*this, all);
+        long total = 0;
+        for (size_t i = 0; i < kShards; ++i) {
+            for (auto it = shards[i].internal.begin(); it != shards[i].internal.end(); ++it) {
+                total += it->second;
+            }
+        }
+        return total;
+    }
+};
+
+void usingTransactions() {
+    TransactionalMapMonitor accounts;
+    // 100 "cuentas" con 100 cada una: el total tiene que ser siempre 10000.
+    for (int key = 0; key < 100; ++key) {
+        accounts.putIfAbsent(key, 100);
+    }
+
+    // Cuatro threads transfiriendo entre cuentas al azar. Leen los dos saldos sin
+    // lock, y confirman con un compare-and-swap doble: si alguien cambió algo en el
+    // medio, la transacción falla entera y se reintenta.
+    std::vector<std::thread> tellers;
+    for (int t = 0; t < 4; ++t) {
+        tellers.push_back(std::thread([&accounts, t] {
+            unsigned seed = t + 1;
+            for (int i = 0; i < 10000; ++i) {
+                int from = rand_r(&seed) % 100;
+                int to = rand_r(&seed) % 100;
+                if (from == to) {
+                    continue;
+                }
+                for (;;) {
+                    int fromBalance, toBalance;
+                    if (!accounts.getIfPresent(from, fromBalance) ||
+                        !accounts.getIfPresent(to, toBalance) || fromBalance == 0) {
+                        break;
+                    }
+                    Transaction tx;
+                    tx.compareAndSwap(from, fromBalance, fromBalance - 1)
+                      .compareAndSwap(to, toBalance, toBalance + 1);
+                    if (accounts.commit(tx)) {
+                        break;
+                    }
+                }
+            }
+        }));
+    }
+
+    std::thread auditor_thread([&] {
+        for (int i = 0; i < 5; ++i) {
+            std::cout << "Total auditado: " << accounts.sum() << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    for (size_t i = 0; i < tellers.size(); ++i) {
+        tellers[i].join();
+    }
+    auditor_thread.join();
+
+    // Mover es borrar una clave e insertar otra, atómicamente.
+    Transaction move;
+    move.move(0, 1000);
+    std::cout << "Mover 0 -> 1000: " << accounts.commit(move) << std::endl;
+    std::cout << "Mover 0 -> 1000 otra vez: " << accounts.commit(move) << std::endl;
+    accounts.printIfPresent(0);
+    accounts.printIfPresent(1000);
+    std::cout << "Total final: " << accounts.sum() << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+    usingTransactions();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Bloquear SIEMPRE en el mismo orden global (acá, el índice del shard) es lo que
+//    evita el deadlock del paso 10 cuando una transacción toma varios mutex.
+// 2. Dos transacciones que no comparten shards no comparten ningún mutex: corren en
+//    paralelo. Cuantos más shards, menos probable que dos claves cualquiera choquen.
+// 3. Adentro de la transacción se aplica y, si algo falla, se deshace. Como los
+//    shards están bloqueados durante todo el commit, nadie ve el estado intermedio.
+// 4. El compare-and-swap permite leer sin locks y confirmar después: si alguien
+//    cambió algo en el medio, la transacción falla entera y se reintenta.
@@ -0,0 +1,215 @@
+// Del paso 1 al 9, los printers rojo, verde y amarillo se turnan como el scheduler
+// quiere. El mutex garantiza que no se pisen, pero NO garantiza un orden.
+//
+// ¿Y si necesitamos alternancia estricta, RED -> GREEN -> YELLOW -> RED...? Con
+// mutex + condition variable se puede, pero cada pase de turno cuesta un lock, un
+// notify, un despertar y otro lock: microsegundos.
+//
+// Armemos una primitiva específica: un "anillo de turnos". Cada thread tiene su
+// propio flag en su propia línea de cache. Pasar el turno es escribir el flag del
+// siguiente; esperar el turno es girar un ratito sobre el flag propio y, si no
+// llega, dormir con un futex (como en el paso 21).
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* ************************************************************************* *
+ * FUTEX - Los mismos helpers del paso 21
+ * ************************************************************************* */
+
+static void futexWait(std::atomic<int> &address, int expected) {
+    syscall(SYS_futex, (int*) &address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futexWake(std::atomic<int> &address, int count) {
+    syscall(SYS_futex, (int*) &address, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* ************************************************************************* *
+ * TURNOS - Un flag por thread, un único escritor por pase
+ * ************************************************************************* */
+
+class TurnRing {
+private:
+    static const int kCacheLine = 64;
+
+    // Los tres estados del flag de cada thread. SLEEPING es "no es mi turno, y
+    // estoy dormido en el futex": así quien pasa el turno sabe si hace falta
+    // despertar a alguien sin un segundo atómico.
+    enum : int {
+        WAITING = 0,
+        HAS_TURN = 1,
+        SLEEPING = 2
+    };
+
+    // Un flag por línea de cache: el que espera gira sobre una línea que nadie más
+    // escribe, hasta que le pasan el turno.
+    struct Slot {
+        std::atomic<int> state;
+        char padding[kCacheLine - sizeof(std::atomic<int>)];
+
+        Slot() : state(WAITING) {}
+    };
+
+    std::vector<Slot> slots;
+    const int spinIterations;
+
+public:
+    // El thread 0 arranca con el turno.
+    explicit TurnRing(int threads) :
+        slots(threads),
+        spinIterations(std::thread::hardware_concurrency() > 1 ? 2000 : 0) {
+        slots[0].state.store(HAS_TURN);
+    }
+
+    TurnRing(const TurnRing&) = delete;
+    TurnRing& operator=(const TurnRing&) = delete;
+
+    void waitTurn(int me) {
+        std::atomic<int> &state = slots[me].state;
+        for (int i = 0; i < spinIterations; ++i) {
+            if (state.load(std::memory_order_acquire) == HAS_TURN) {
+                return;
+            }
+            cpuRelax();
+        }
+        for (;;) {
+            int expected = WAITING;
+            // Anunciamos que vamos a dormir. Si falla, es porque ya tenemos el turno.
+            if (state.compare_exchange_strong(expected, SLEEPING, std::memory_order_acq_rel) ||
+                expected == SLEEPING) {
+                futexWait(state, SLEEPING);
+            }
+            if (state.load(std::memory_order_acquire) == HAS_TURN) {
+                return;
+            }
+        }
+    }
+
+    void passTurn(int me) {
+        slots[me].state.store(WAITING, std::memory_order_relaxed);
+        std::atomic<int> &next = slots[(me + 1) % slots.size()].state;
+        // Solo entramos al kernel si el siguiente se durmió.
+        if (next.exchange(HAS_TURN, std::memory_order_acq_rel) == SLEEPING) {
+            futexWake(next, 1);
+        }
+    }
+};
+
+// La versión con mutex + condition variable, para comparar.
+class CondVarTurns {
+private:
+    const int threads;
+    int turn;
+    std::mutex mutex;
+    std::condition_variable changed;
+
+public:
+    explicit CondVarTurns(int threads) : threads(threads), turn(0) {}
+
+    void waitTurn(int me) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return turn == me; });
+    }
+
+    void passTurn(int me) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            turn = (me + 1) % threads;
+        }
+        changed.notify_all();
+    }
+};
+
+/* ************************************************************************* *
+ * USO - Printers en ronda estricta
+ * ************************************************************************* */
+
+void printersTakingTurns() {
+    TurnRing ring(3);
+    const char *colors[] = {"\x1B[31m", "\x1B[32m", "\x1B[33m"};
+    const char *names[] = {"RED", "GREEN", "YELLOW"};
+
+    std::vector<std::thread> printers;
+    for (int p = 0; p < 3; ++p) {
+        printers.push_back(std::thread([&, p] {
+            for (int i = 0; i < 5; ++i) {
+                ring.waitTurn(p);
+                // Mientras tengo el turno nadie más imprime: el turno también es
+                // exclusión mutua.
+                std::cout << colors[p] << names[p] << "\033[0m" << std::endl;
+                ring.passTurn(p);
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < printers.size(); ++i) {
+        printers[i].join();
+    }
+}
+
+/* ************************************************************************* *
+ * BENCHMARK - Ping-pong entre dos threads
+ * ************************************************************************* */
+
+template <class Turns>
+double nanosPerHandoff(int rounds) {
+    Turns turns(2);
+    auto start = std::chrono::steady_clock::now();
+    std::thread ping([&] {
+        for (int i = 0; i < rounds; ++i) {
+            turns.waitTurn(0);
+            turns.passTurn(0);
+        }
+    });
+    std::thread pong([&] {
+        for (int i = 0; i < rounds; ++i) {
+            turns.waitTurn(1);
+            turns.passTurn(1);
+        }
+    });
+    pong.join();
+    ping.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // Cada ronda son dos pases de turno: ping -> pong y pong -> ping.
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return double(nanos) / (2.0 * rounds);
+}
+
+void benchmarkHandoffs() {
+    const int rounds = 100000;
+    std::cout << "TurnRing: " << nanosPerHandoff<TurnRing>(rounds) << " ns por pase" << std::endl;
+    std::cout << "mutex + condition_variable: " << nanosPerHandoff<CondVarTurns>(rounds)
+              << " ns por pase" << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+    printersTakingTurns();
+    benchmarkHandoffs();
+    return 0;
+}
+
+// A tener en cuenta:
+// 1. Cada flag tiene UN solo escritor por vez (el que pasa el turno, o el dueño
+//    anunciando que se duerme), y vive en su propia línea de cache.
+// 2. Los pases por debajo del microsegundo solo se ven con los threads en cores
+//    distintos y girando. Con un solo core, o con más threads que cores, el pase
+//    implica un cambio de contexto, y eso cuesta microsegundos sí o sí.
+// 3. El estado SLEEPING evita el syscall en el caso común: si el siguiente todavía
+//    está girando, pasarle el turno es un único exchange.
+// 4. Un turno estricto también serializa: si un thread se demora, TODOS esperan.